@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ActorPoolSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "ReusableActor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogActorPool, Log, All);
+
+UActorPoolSubsystem* UActorPoolSubsystem::Get(const UObject* WorldContextObject)
+{
+	auto* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	return World ? World->GetSubsystem<UActorPoolSubsystem>() : nullptr;
+}
+
+bool UActorPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UActorPoolSubsystem::Deinitialize()
+{
+	UE_LOG(LogActorPool, Log, TEXT("UActorPoolSubsystem::Deinitialize: %d actors spawned by the pool"), NumSpawned);
+	Pools.Empty();
+	Super::Deinitialize();
+}
+
+AActor* UActorPoolSubsystem::Acquire(TSubclassOf<AActor> Class, const FTransform& Transform, bool bFailIfColliding)
+{
+	auto* World = GetWorld();
+	if (!Class || !World)
+	{
+		return nullptr;
+	}
+	if (bFailIfColliding && World->EncroachingBlockingGeometry(Class->GetDefaultObject<AActor>(), Transform.GetLocation(), Transform.Rotator()))
+	{
+		return nullptr;
+	}
+
+	AActor* Actor = nullptr;
+	if (auto* Entry = Pools.Find(Class.Get()))
+	{
+		while (!Actor && Entry->FreeActors.Num() > 0)
+		{
+			Actor = Entry->FreeActors.Pop(EAllowShrinking::No);
+			if (!IsValid(Actor))
+			{
+				Actor = nullptr; // 被外部销毁了，例如关卡卸载
+			}
+		}
+	}
+	if (Actor)
+	{
+		Activate(Actor, Transform);
+	}
+	else
+	{
+		Actor = SpawnPooledActor(Class, Transform);
+		if (!Actor)
+		{
+			return nullptr;
+		}
+	}
+
+	if (Actor->Implements<UReusableActor>())
+	{
+		IReusableActor::Execute_OnAcquiredFromPool(Actor);
+	}
+	return Actor;
+}
+
+void UActorPoolSubsystem::Release(AActor* Actor)
+{
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+	Park(Actor);
+	auto& Entry = Pools.FindOrAdd(Actor->GetClass());
+	checkSlow(!Entry.FreeActors.Contains(Actor)); // 同一个 actor 不能放回两次
+	Entry.FreeActors.Add(Actor);
+}
+
+void UActorPoolSubsystem::Prewarm(TSubclassOf<AActor> Class, int32 Count)
+{
+	if (!Class || Count <= 0)
+	{
+		return;
+	}
+	// actor 的 BeginPlay 可能会向池中添加其它类，不能跨 spawn 持有 Pools 中的引用
+	while (GetNumFree(Class) < Count)
+	{
+		auto* Actor = SpawnPooledActor(Class, FTransform::Identity);
+		if (!Actor)
+		{
+			break;
+		}
+		Park(Actor);
+		Pools.FindOrAdd(Class.Get()).FreeActors.Add(Actor);
+	}
+	UE_LOG(LogActorPool, Log, TEXT("UActorPoolSubsystem::Prewarm: %s has %d free actors"), *Class->GetName(), GetNumFree(Class));
+}
+
+int32 UActorPoolSubsystem::GetNumFree(TSubclassOf<AActor> Class) const
+{
+	const auto* Entry = Pools.Find(Class.Get());
+	return Entry ? Entry->FreeActors.Num() : 0;
+}
+
+void UActorPoolSubsystem::Park(AActor* Actor)
+{
+	// 预热的 actor 和 Park 之后的 actor 也要停止自己在其它地方注册的更新，例如 UWheelLaserSubsystem
+	if (Actor->Implements<UReusableActor>())
+	{
+		IReusableActor::Execute_OnReturnedToPool(Actor);
+	}
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	// 组件的 tick 和 actor 的 tick 是分开的，例如 movement 组件
+	Actor->ForEachComponent(false, [](UActorComponent* Component) {
+		Component->SetComponentTickEnabled(false);
+	});
+}
+
+void UActorPoolSubsystem::Activate(AActor* Actor, const FTransform& Transform)
+{
+	// 先移动再打开碰撞，避免在旧位置上产生重叠事件
+	Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	// 恢复成类默认值，默认隐藏或者没有碰撞的 actor 不能被打开
+	const auto* CDO = Actor->GetClass()->GetDefaultObject<AActor>();
+	Actor->SetActorHiddenInGame(CDO->IsHidden());
+	Actor->SetActorEnableCollision(CDO->GetActorEnableCollision());
+	Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+	Actor->ForEachComponent(false, [](UActorComponent* Component) {
+		Component->SetComponentTickEnabled(Component->PrimaryComponentTick.bStartWithTickEnabled);
+	});
+}
+
+AActor* UActorPoolSubsystem::SpawnPooledActor(UClass* Class, const FTransform& Transform)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	auto* Actor = GetWorld()->SpawnActor<AActor>(Class, Transform, SpawnParams);
+	if (Actor)
+	{
+		++NumSpawned;
+		UE_LOG(LogActorPool, Verbose, TEXT("UActorPoolSubsystem::SpawnPooledActor: spawn %s, %d actors spawned"), *Class->GetName(), NumSpawned);
+	}
+	return Actor;
+}
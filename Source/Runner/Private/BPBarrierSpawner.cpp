@@ -1,68 +1,88 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "BPBarrierSpawner.h"
-#include "Containers/AllowShrinking.h"
+#include "ActorPoolSubsystem.h"
 #include "Engine/World.h"
+#include "EngineUtils.h"
 #include "GameFramework/Actor.h"
 #include "UObject/WeakObjectPtrTemplates.h"
+#include "WorldGenerator.h"
 
-void ABPBarrierSpawner::SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator)
+void ABPBarrierSpawner::BeginPlay()
 {
+	Super::BeginPlay();
+	if (auto* Pool = UActorPoolSubsystem::Get(this))
+	{
+		// 按最高难度预热，难度提升之后也不需要再 spawn
+		auto Count = PoolSizePerDifficulty.Num() > 0 ? FMath::Max(PoolSizePerDifficulty) : GetDefaultPoolSize();
+		PrewarmPool(*Pool, Count);
+	}
+}
+
+int32 ABPBarrierSpawner::GetDefaultPoolSize() const
+{
+	TActorIterator<AWorldGenerator> It(GetWorld());
+	if (!It || MaxBarrierCount.Num() == 0)
+	{
+		return 0;
+	}
+	return FMath::Max(MaxBarrierCount) * It->GetMaxResidentTileNumber();
+}
+
+void ABPBarrierSpawner::PrewarmPool(UActorPoolSubsystem& Pool, int32 Count) const
+{
+	Pool.Prewarm(BarrierClass, Count);
+}
+
+AActor* ABPBarrierSpawner::AcquireBarrier(TSubclassOf<AActor> Class, const FTransform& Transform, FInt32Point Tile, bool bFailIfColliding)
+{
+	auto* Pool = UActorPoolSubsystem::Get(this);
+	auto* Actor = Pool ? Pool->Acquire(Class, Transform, bFailIfColliding) : nullptr;
+	if (Actor)
+	{
+		SpawnedBarriers.FindOrAdd(Tile).Add(Actor);
+	}
+	return Actor;
+}
+
+bool ABPBarrierSpawner::SpawnBarriers(FBarrierSpawnContext& Context)
+{
+	auto* WorldGenerator = Context.WorldGenerator;
+	auto Tile = Context.Tile;
 	if (!WorldGenerator || !BarrierClass)
 	{
-		return;
+		return true;
 	}
 
-	for (auto& Point : Positions)
+	for (; !Context.IsFinished() && !Context.ShouldYield(); ++Context.Cursor)
 	{
+		auto Point = Context.Positions[Context.Cursor];
 		if (!CanSpawnThisBarrier(Tile, Point.UVPos, WorldGenerator))
 		{
 			continue; // 跳过不允许生成障碍物的区域
 		}
 
 		FTransform Transform;
-		GetTransformFromSeed(Transform, Point, Tile, WorldGenerator);
-		AActor* CachedActor = nullptr;
-
-		// 检查是否有缓存的障碍物可用
-		while (CachedBarriers.Num() > 0)
-		{
-			TWeakObjectPtr<AActor> CachedBarrier = CachedBarriers.Pop(EAllowShrinking::No);
-			CachedActor = CachedBarrier.Get();
-			if (CachedActor)
-			{
-				break;
-			}
-		}
-		if (CachedActor)
-		{
-			CachedActor->SetActorRelativeTransform(Transform);
-		}
-		else
-		{
-			CachedActor = GetWorld()->SpawnActor<AActor>(BarrierClass, Transform);
-		}
-		SpawnedBarriers.Add(Tile, CachedActor);
+		GetTransformFromSeed(Transform, Context);
+		AcquireBarrier(BarrierClass, Transform, Tile);
+		Context.Budget->Consume();
 	}
+	return Context.IsFinished();
 }
 
 void ABPBarrierSpawner::RemoveTile(FInt32Point Tile)
 {
-	TArray<TWeakObjectPtr<AActor>> OutValues;
-	SpawnedBarriers.MultiFind(Tile, OutValues);
-	for (auto WeakActor : OutValues)
+	auto* Barriers = SpawnedBarriers.Find(Tile);
+	if (!Barriers)
 	{
-		if (CachedBarriers.Num() < MaxCachedBarriers)
-		{
-			CachedBarriers.Add(WeakActor);
-		}
-		else
+		return;
+	}
+	if (auto* Pool = UActorPoolSubsystem::Get(this))
+	{
+		// 被收集的金币等只是暂停在原地，也在这里放回对象池
+		for (auto WeakActor : *Barriers)
 		{
-			// 如果缓存已满，直接销毁
-			if (AActor* Actor = WeakActor.Get())
-			{
-				Actor->Destroy();
-			}
+			Pool->Release(WeakActor.Get());
 		}
 	}
 	SpawnedBarriers.Remove(Tile);
@@ -70,26 +90,17 @@ void ABPBarrierSpawner::RemoveTile(FInt32Point Tile)
 
 void ABPBarrierSpawner::MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX)
 {
-	TMultiMap<FInt32Point, TWeakObjectPtr<AActor>> NewSpawnedBarriers;
-	NewSpawnedBarriers.Reserve(SpawnedBarriers.Num());
-
-	for (auto& It : SpawnedBarriers)
-	{
-		auto NewKey = FInt32Point(It.Key.X - TileXOffset, It.Key.Y);
-		if (AActor* Actor = It.Value.Get())
-		{
-			Actor->AddActorWorldOffset(FVector(-WorldOffsetX, 0.0, 0.0));
-			NewSpawnedBarriers.Add(NewKey, TWeakObjectPtr<AActor>(Actor));
-		}
-	}
-	SpawnedBarriers = MoveTemp(NewSpawnedBarriers);
-
-	// TODO: 是否需要处理 CachedBarriers？
-	for (auto& WeakActor : CachedBarriers)
-	{
-		if (AActor* Actor = WeakActor.Get())
-		{
-			Actor->AddActorWorldOffset(FVector(-WorldOffsetX, 0.0, 0.0));
-		}
-	}
+	// tile 编号由容器换算，这里只需要移动 actor
+	SpawnedBarriers.MoveWorldOrigin(TileXOffset);
+	SpawnedBarriers.ForEach([WorldOffsetX](FInt32Point, TArray<TWeakObjectPtr<AActor>>& Barriers) {
+		Barriers.RemoveAllSwap([WorldOffsetX](const TWeakObjectPtr<AActor>& WeakActor) {
+			AActor* Actor = WeakActor.Get();
+			if (Actor)
+			{
+				Actor->AddActorWorldOffset(FVector(-WorldOffsetX, 0.0, 0.0));
+			}
+			return Actor == nullptr;
+		});
+	});
+	// 池中空闲的 actor 在取出时会重新设置 transform，不需要移动
 }
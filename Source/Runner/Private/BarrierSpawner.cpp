@@ -1,8 +1,8 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "BarrierSpawner.h"
-#include "Math/RotationMatrix.h"
 #include "Math/UnrealMathUtility.h"
+#include "SpawnTransform.h"
 #include "WorldGenerator.h"
 
 DEFINE_LOG_CATEGORY(LogBarrierSpawner);
@@ -15,6 +15,36 @@ ABarrierSpawner::ABarrierSpawner()
 	PrimaryActorTick.bStartWithTickEnabled = false;
 }
 
+void ABarrierSpawner::FillGenConfig(FSpawnerGenConfig& OutConfig) const
+{
+	OutConfig.BarrierGroup = BarrierGroup;
+	OutConfig.PoissonDistance = PoissonDistance;
+	OutConfig.MinBarrierCount = MinBarrierCount;
+	OutConfig.MaxBarrierCount = MaxBarrierCount;
+	OutConfig.bPlanTransforms = !bDeferSpawn;
+	OutConfig.Transform.AlignMode = AlignMode;
+	OutConfig.Transform.BarrierOffset = BarrierOffset;
+	OutConfig.Transform.BarrierRadius = BarrierRadius;
+	// GetRotationFromSeed 应当是种子的一次函数，用两个端点就能确定
+	auto& Params = OutConfig.Transform;
+	Params.BaseRotation = GetRotationFromSeed(FRotator::ZeroRotator);
+	Params.SeedRotationScale = GetRotationFromSeed(FRotator(1.0, 1.0, 1.0)) - Params.BaseRotation;
+
+	// 子类的实现不一定满足，再用第三个点检查一次，不满足时 worker 不计算 transform，改为在 game 线程上调用 GetRotationFromSeed
+	const FRotator Probe(0.25, 0.5, 0.75);
+	const FRotator Expected(
+			Params.BaseRotation.Pitch + Params.SeedRotationScale.Pitch * Probe.Pitch,
+			Params.BaseRotation.Yaw + Params.SeedRotationScale.Yaw * Probe.Yaw,
+			Params.BaseRotation.Roll + Params.SeedRotationScale.Roll * Probe.Roll);
+	auto Actual = GetRotationFromSeed(Probe);
+	if (!Actual.Equals(Expected, 1e-3))
+	{
+		UE_LOG(LogBarrierSpawner, Warning, TEXT("%s: GetRotationFromSeed is not linear in the seed (expected %s, got %s), transforms are computed on the game thread"), *GetName(), *Expected.ToString(), *Actual.ToString());
+		Params.bAffineRotation = false;
+		OutConfig.bPlanTransforms = false;
+	}
+}
+
 FRotator ABarrierSpawner::GetRotationFromSeed(FRotator Seed) const
 {
 	FRotator Result = FRotator::ZeroRotator;
@@ -22,61 +52,34 @@ FRotator ABarrierSpawner::GetRotationFromSeed(FRotator Seed) const
 	return Result;
 }
 
-void ABarrierSpawner::GetTransformFromSeed(FTransform& OutTransform, const RandomPoint& Seed, FInt32Point Tile, AWorldGenerator* WorldGenerator) const
+void ABarrierSpawner::GetTransformFromSeed(FTransform& OutTransform, const FBarrierSpawnContext& Context) const
 {
-	// 重映射 UV，避免生成在边缘位置
-	FVector2D UVPos = FVector2D::ZeroVector;
-	UVPos.X = FMath::Lerp(0.01, 0.99, Seed.UVPos.X);
-	UVPos.Y = FMath::Lerp(0.01, 0.99, Seed.UVPos.Y);
-
-	auto Location = WorldGenerator->GetVisualWorldPositionFromUV(UVPos, Tile);
-	auto Rotation = GetRotationFromSeed(Seed.Rotation);
-	TransformAlign(Location, Rotation, WorldGenerator);
-	OutTransform.SetLocation(Location);
-	OutTransform.SetRotation(Rotation.Quaternion());
-}
-
-void ABarrierSpawner::TransformAlign(FVector& Location, FRotator& Rotation, class AWorldGenerator* WorldGenerator) const
-{
-	// 对齐到地面法线
-	if (AlignMode == EAlignMode::AlignNormal)
+	auto* WorldGenerator = Context.WorldGenerator;
+	const auto* Plan = Context.Plan;
+	if (Plan && Plan->PointTransforms.Num() == Context.Positions.Num())
 	{
-		auto Normal = WorldGenerator->GetNormalFromHorizontalPos(FVector2D(Location));
-
-		auto ForwardDir = FRotator(0.0, Rotation.Yaw, 0.0).Vector();
-		// 取 80 是为了避免超出边界
-		auto ForwardPos = Location + ForwardDir * FMath::Min((BarrierRadius / 2), 80.0f);
-
-		ForwardPos.Z = WorldGenerator->GetVisualHeightFromHorizontalPos(FVector2D(ForwardPos));
-		auto Pitch = (ForwardPos - Location).GetSafeNormal();
-
-		auto AlignedRotation = FRotationMatrix::MakeFromXZ(Pitch, Normal).Rotator();
-
-		Rotation.Pitch += AlignedRotation.Pitch;
-		Rotation.Roll += AlignedRotation.Roll;
+		OutTransform = Plan->PointTransforms[Context.Cursor];
+		OutTransform.AddToTranslation(Plan->GetOriginShift(WorldGenerator->WorldOriginOffset.X));
+		return;
+	}
 
-		Location += Normal * BarrierOffset;
+	// 没有规划结果（例如规划之后修改了 spawner），用当前的快照在 game 线程上计算
+	auto Config = WorldGenerator->GetGenConfig();
+	if (!ensure(Config->Spawners.IsValidIndex(Context.SpawnerIndex)))
+	{
+		OutTransform = FTransform::Identity;
+		return;
 	}
-	// 对齐到重力方向
-	else if (AlignMode == EAlignMode::AlignGravity)
+	FTerrainHeightSampler Sampler(*Config);
+	const auto& Params = Config->Spawners[Context.SpawnerIndex].Transform;
+	auto Seed = Context.Positions[Context.Cursor];
+	if (Params.bAffineRotation)
 	{
-		// ax + by + cz = 0
-		// x^2 + y^2 = Radius^2
-		// Z_min = -sqrt((a^2 + b^2)(x^2 + y^2)) / c = -sqrt(1 - Normal.Z^2) * Radius / Normal.Z
-		auto Normal = WorldGenerator->GetNormalFromHorizontalPos(FVector2D(Location));
-
-		double Zoffset = 0.0;
-		if (Normal.Z > UE_SMALL_NUMBER)
-		{
-			Zoffset = -FMath::Sqrt((1 - Normal.Z * Normal.Z)) * BarrierRadius / Normal.Z;
-		}
-		Zoffset += BarrierOffset;
-
-		Location += FVector(0, 0, Zoffset);
+		OutTransform = SpawnTransform::FromSeed(*Config, Params, Sampler, Context.Tile, Seed);
 	}
 	else
 	{
-		Location += FVector(0, 0, BarrierOffset);
+		OutTransform = SpawnTransform::FromSeed(*Config, Params, Sampler, Context.Tile, Seed, GetRotationFromSeed(Seed.Rotation));
 	}
 }
 
@@ -94,27 +97,10 @@ bool ABarrierSpawner::CanSpawnThisBarrier(FInt32Point Tile, FVector2D UVPos, AWo
 	}
 	else
 	{
-		for (const auto& It : WorldGenerator->CachedSpawnData)
+		// 延迟 spawn 的物体周围和特殊激光附近不允许生成障碍物
+		if (WorldGenerator->ExclusionIndex.IsExcluded(Tile, UVPos))
 		{
-			if (It.Key.X == Tile.X && It.Key.Y == Tile.Y)
-			{
-				auto PosUV = It.Value.Value;
-				auto bProximity = FMath::Abs(PosUV.X - UVPos.X) <= 0.15 && FMath::Abs(PosUV.Y - UVPos.Y) <= 0.15;
-				if (bProximity)
-				{
-					return false;
-				}
-			}
-		}
-		for (auto LaserPos : WorldGenerator->SpecialLaserPos)
-		{
-			// 激光位置不允许生成障碍物
-			auto BarrierPos = FMath::Fmod(Tile.X + UVPos.X, double(WorldGenerator->MoveOriginXTile));
-			auto Distance = FMath::Abs(LaserPos - BarrierPos);
-			if (Distance < 0.05 || Distance > (double(WorldGenerator->MoveOriginXTile) - 0.05))
-			{
-				return false;
-			}
+			return false;
 		}
 	}
 	return true;
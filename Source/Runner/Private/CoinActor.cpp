@@ -1,6 +1,7 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "CoinActor.h"
+#include "ActorPoolSubsystem.h"
 #include "Components/SceneComponent.h"
 #include "Components/SphereComponent.h"
 #include "Components/StaticMeshComponent.h"
@@ -11,8 +12,8 @@
 // Sets default values
 ACoinActor::ACoinActor()
 {
-	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false; // 被吸引时才 tick
 	StaticMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("StaticMesh"));
 	RootComponent = StaticMesh;
 	Collision = CreateDefaultSubobject<USphereComponent>(TEXT("Collision"));
@@ -25,12 +26,20 @@ void ACoinActor::BeginPlay()
 {
 	Super::BeginPlay();
 	Collision->OnComponentBeginOverlap.AddDynamic(this, &ACoinActor::DealOverlap);
+	if (!bMaterialDrivesMotion)
+	{
+		SetActorTickEnabled(true);
+	}
 }
 
 // Called every frame
 void ACoinActor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	if (!bMaterialDrivesMotion)
+	{
+		TickMotion(DeltaTime);
+	}
 	if (bAttracted)
 	{
 		CurrentAttractTime += DeltaTime;
@@ -46,17 +55,35 @@ void ACoinActor::Tick(float DeltaTime)
 	}
 }
 
+void ACoinActor::OnAcquiredFromPool_Implementation()
+{
+	bAttracted = false;
+	CurrentAttractTime = 0.0f;
+	// 对象池按类默认值恢复 tick，默认只在被吸引时 tick
+	if (!bMaterialDrivesMotion)
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+void ACoinActor::StartAttract()
+{
+	bAttracted = true;
+	SetActorTickEnabled(true);
+}
+
 void ACoinActor::DealOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
 	if (OtherComp)
 	{
 		if (OtherComp->ComponentHasTag("Activate"))
 		{
-			bAttracted = true;
+			StartAttract();
 		}
 		else if (OtherComp->ComponentHasTag("Absorb"))
 		{
-			Destroy();
+			// 由 spawner 在 tile 移除时放回对象池
+			UActorPoolSubsystem::Park(this);
 		}
 	}
 }
@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoinFieldComponent.h"
+#include "Components/SphereComponent.h"
+#include "Engine/World.h"
+#include "ISMInstanceBatch.h"
+#include "Kismet/GameplayStatics.h"
+#include "Runner/RunnerCharacter.h"
+#include "RunnerCoinActor.h"
+
+UCoinFieldComponent::UCoinFieldComponent(const FObjectInitializer& ObjectInitializer)
+		: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false; // 有金币时才 tick
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;		// 玩家移动之后再检测
+	SetMobility(EComponentMobility::Movable);
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetGenerateOverlapEvents(false);
+}
+
+void UCoinFieldComponent::InitFromTemplate(const ACoinActor* Template)
+{
+	if (!Template)
+	{
+		return;
+	}
+	// spawn 时模板根组件的 transform 会乘在 actor 的 transform 上
+	const auto* Root = Template->GetRootComponent();
+	auto RootTransform = Root ? Root->GetRelativeTransform() : FTransform::Identity;
+	auto GetTemplateTransform = [Root, &RootTransform](const USceneComponent* Component) {
+		return Component == Root ? RootTransform : Component->GetRelativeTransform() * RootTransform;
+	};
+
+	// 关卡中已经设置过网格体时保留关卡的设置
+	const auto* Mesh = Template->StaticMesh.Get();
+	if (Mesh && !GetStaticMesh())
+	{
+		SetStaticMesh(Mesh->GetStaticMesh());
+		for (int32 MaterialIndex = 0; MaterialIndex < Mesh->GetNumOverrideMaterials(); ++MaterialIndex)
+		{
+			SetMaterial(MaterialIndex, Mesh->OverrideMaterials[MaterialIndex]);
+		}
+		SetCastShadow(Mesh->CastShadow);
+		MeshTransform = GetTemplateTransform(Mesh);
+	}
+	// 复制的材质通过 custom primitive data 读取旋转速度，ISM 上所有实例共用这一份
+	if (const auto* RunnerCoin = Cast<ARunnerCoinActor>(Template))
+	{
+		SetCustomPrimitiveDataFloat(ARunnerCoinActor::SpinSpeedDataIndex, RunnerCoin->SpinSpeed);
+		TickSpinSpeed = RunnerCoin->bMaterialDrivesMotion ? 0.0f : RunnerCoin->SpinSpeed;
+	}
+
+	if (const auto* Sphere = Template->Collision.Get())
+	{
+		CoinRadius = Sphere->GetUnscaledSphereRadius() * GetTemplateTransform(Sphere).GetScale3D().GetAbsMin();
+		// 和 EncroachingBlockingGeometry 一样使用碰撞球的对象类型和响应
+		auto bCanBlock = Sphere->GetCollisionEnabled() != ECollisionEnabled::NoCollision;
+		BlockingRadius = bCanBlock ? CoinRadius : 0.0f;
+		BlockingObjectType = Sphere->GetCollisionObjectType();
+		BlockingResponses = FCollisionResponseParams(Sphere->GetCollisionResponseToChannels());
+	}
+}
+
+void UCoinFieldComponent::SetBlockingTest(float Radius, ECollisionChannel ObjectType)
+{
+	BlockingRadius = Radius;
+	BlockingObjectType = ObjectType;
+	BlockingResponses = FCollisionResponseParams::DefaultResponseParam;
+}
+
+bool UCoinFieldComponent::IsBlocked(const FVector& Position) const
+{
+	if (BlockingRadius <= 0.0f)
+	{
+		return false;
+	}
+	return GetWorld()->OverlapBlockingTestByChannel(Position, FQuat::Identity, BlockingObjectType, FCollisionShape::MakeSphere(BlockingRadius), FCollisionQueryParams::DefaultQueryParam, BlockingResponses);
+}
+
+void UCoinFieldComponent::AddCoins(FISMInstanceBatch& Batch, TArray<int32>& OutIndices)
+{
+	if (Batch.IsEmpty())
+	{
+		return;
+	}
+	auto FirstIndex = OutIndices.Num();
+	Batch.Commit(this, FreeCoins, OutIndices);
+
+	auto InstanceNumber = GetNumInstances();
+	Positions.SetNum(InstanceNumber);
+	Rotations.SetNum(InstanceNumber);
+	AttractElapsed.SetNum(InstanceNumber);
+	States.SetNum(InstanceNumber); // 新的元素为 0，即 Free
+
+	FTransform Transform;
+	for (int32 i = FirstIndex; i < OutIndices.Num(); ++i)
+	{
+		auto CoinIndex = OutIndices[i];
+		GetInstanceTransform(CoinIndex, Transform, true);
+		Positions[CoinIndex] = Transform.GetLocation();
+		Rotations[CoinIndex] = Transform.GetRotation();
+		AttractElapsed[CoinIndex] = 0.0f;
+		States[CoinIndex] = ECoinState::Idle;
+	}
+	SetActiveCoins(NumActiveCoins + OutIndices.Num() - FirstIndex);
+}
+
+void UCoinFieldComponent::RemoveCoins(TConstArrayView<int32> CoinIndices)
+{
+	auto RemovedActive = 0;
+	for (auto CoinIndex : CoinIndices)
+	{
+		auto& State = States[CoinIndex];
+		if (State == ECoinState::Idle || State == ECoinState::Attracted)
+		{
+			++RemovedActive;
+		}
+		State = ECoinState::Free;
+	}
+	FreeCoins.Append(CoinIndices.GetData(), CoinIndices.Num());
+	// 已拾取的金币已经隐藏了，这里一起处理，区间更连续
+	FISMInstanceBatch::HideInstances(this, CoinIndices);
+	SetActiveCoins(NumActiveCoins - RemovedActive);
+}
+
+void UCoinFieldComponent::MoveWorldOrigin(double WorldOffsetX)
+{
+	auto Offset = FVector(-WorldOffsetX, 0.0, 0.0);
+	for (auto& Position : Positions)
+	{
+		Position += Offset;
+	}
+	FISMInstanceBatch::OffsetAllInstances(this, Offset);
+}
+
+void UCoinFieldComponent::SetActiveCoins(int32 Number)
+{
+	NumActiveCoins = Number;
+	SetComponentTickEnabled(NumActiveCoins > 0);
+}
+
+bool UCoinFieldComponent::GetPlayerSpheres(FSphere& OutActivate, FSphere& OutAbsorb)
+{
+	if (!Player.IsValid())
+	{
+		Player = Cast<ARunnerCharacter>(UGameplayStatics::GetPlayerCharacter(this, 0));
+		ActivateComp = nullptr;
+		if (Player.IsValid())
+		{
+			Player->ForEachComponent<UPrimitiveComponent>(false, [this](UPrimitiveComponent* Component) {
+				if (Component->ComponentHasTag("Activate"))
+				{
+					ActivateComp = Component;
+				}
+			});
+		}
+	}
+	if (!Player.IsValid() || !Player->AbsorbComp)
+	{
+		return false;
+	}
+
+	auto ToSphere = [](const UPrimitiveComponent* Component) {
+		const auto* SphereComponent = Cast<USphereComponent>(Component);
+		auto Radius = SphereComponent ? SphereComponent->GetScaledSphereRadius() : Component->Bounds.SphereRadius;
+		return FSphere(Component->GetComponentLocation(), Radius);
+	};
+	OutAbsorb = ToSphere(Player->AbsorbComp);
+	// 没有 Activate 球体时金币不会被吸引，只会被直接拾取
+	OutActivate = ActivateComp.IsValid() ? ToSphere(ActivateComp.Get()) : FSphere(OutAbsorb.Center, 0.0);
+	return true;
+}
+
+void UCoinFieldComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	FSphere Activate, Absorb;
+	if (!GetPlayerSpheres(Activate, Absorb))
+	{
+		return;
+	}
+	auto ActivateDistSquared = FMath::Square(Activate.W + CoinRadius);
+	auto AbsorbDistSquared = FMath::Square(Absorb.W + CoinRadius);
+
+	CollectedCoins.Reset();
+	MovedCoins.Reset();
+	MovedTransforms.Reset();
+	// 和 ARunnerCoinActor::TickMotion 一样绕 actor 的本地 Z 轴旋转，实例的旋转还要乘上网格体的相对旋转
+	auto bSpin = TickSpinSpeed != 0.0f;
+	auto MeshRotation = MeshTransform.GetRotation();
+	auto SpinDelta = MeshRotation.Inverse() * FQuat(FRotator(0.0, TickSpinSpeed * DeltaTime, 0.0)) * MeshRotation;
+	for (int32 CoinIndex = 0; CoinIndex < States.Num(); ++CoinIndex)
+	{
+		auto& State = States[CoinIndex];
+		if (State != ECoinState::Idle && State != ECoinState::Attracted)
+		{
+			continue;
+		}
+		auto& Position = Positions[CoinIndex];
+		if (bSpin)
+		{
+			Rotations[CoinIndex] *= SpinDelta;
+		}
+		if (State == ECoinState::Attracted)
+		{
+			AttractElapsed[CoinIndex] += DeltaTime;
+			auto Alpha = FMath::Clamp(AttractElapsed[CoinIndex] / AttractTime, 0.0f, 1.0f);
+			Position = FMath::Lerp(Position, Absorb.Center, Alpha);
+		}
+		if (bSpin || State == ECoinState::Attracted)
+		{
+			MovedCoins.Add(CoinIndex);
+			MovedTransforms.Add(FTransform(Rotations[CoinIndex], Position, MeshTransform.GetScale3D()));
+		}
+
+		if (FVector::DistSquared(Position, Absorb.Center) <= AbsorbDistSquared)
+		{
+			State = ECoinState::Collected;
+			CollectedCoins.Add(CoinIndex);
+		}
+		else if (State == ECoinState::Idle && FVector::DistSquared(Position, Activate.Center) <= ActivateDistSquared)
+		{
+			State = ECoinState::Attracted;
+			AttractElapsed[CoinIndex] = 0.0f;
+		}
+	}
+
+	// 先提交移动，再隐藏被拾取的金币，否则这一帧飞到玩家处的金币会被重新显示
+	CommitMovedCoins();
+	if (CollectedCoins.Num() > 0)
+	{
+		FISMInstanceBatch::HideInstances(this, CollectedCoins);
+		for (int32 i = 0; i < CollectedCoins.Num(); ++i)
+		{
+			Player->CollectCoin();
+		}
+		SetActiveCoins(NumActiveCoins - CollectedCoins.Num());
+	}
+	else if (MovedCoins.Num() > 0)
+	{
+		MarkRenderStateDirty();
+	}
+}
+
+void UCoinFieldComponent::CommitMovedCoins()
+{
+	int32 RunStart = 0;
+	for (int32 i = 1; i <= MovedCoins.Num(); ++i)
+	{
+		if (i < MovedCoins.Num() && MovedCoins[i] == MovedCoins[i - 1] + 1)
+		{
+			continue;
+		}
+		RunTransforms.Reset();
+		RunTransforms.Append(MovedTransforms.GetData() + RunStart, i - RunStart);
+		BatchUpdateInstancesTransforms(MovedCoins[RunStart], RunTransforms, true, false, true);
+		RunStart = i;
+	}
+}
@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoinTrajectory.h"
+#include "RunnerMovementComponent.h"
+#include "WorldGenerator.h"
+
+// 和 AWorldGenerator::GetTriangleFromUV 以及 TrianglesBuffer 的顶点顺序一致
+FTerrainHeightSampler::FTriangleSample FTerrainHeightSampler::GetTriangle(FVector2D Pos) const
+{
+	auto TileXSize = Config.GetTileSizeX();
+	auto TileYSize = Config.GetTileSizeY();
+	FTriangleSample Sample;
+	Sample.Tile = FInt32Point(FMath::FloorToInt32(Pos.X / TileXSize), FMath::FloorToInt32(Pos.Y / TileYSize));
+
+	double X = (Pos.X - Sample.Tile.X * TileXSize) / TileXSize * Config.XCellNumber;
+	double Y = (Pos.Y - Sample.Tile.Y * TileYSize) / TileYSize * Config.YCellNumber;
+	int32 CellX = FMath::Clamp(FMath::FloorToInt32(X), 0, Config.XCellNumber - 1);
+	int32 CellY = FMath::Clamp(FMath::FloorToInt32(Y), 0, Config.YCellNumber - 1);
+	double CoordX = X - CellX;
+	double CoordY = Y - CellY;
+
+	if (CoordX + CoordY > 1.0)
+	{
+		// 右下角的三角形
+		Sample.Corners[0] = FInt32Point(CellX + 1, CellY + 1);
+		Sample.Corners[1] = FInt32Point(CellX + 1, CellY);
+		Sample.Corners[2] = FInt32Point(CellX, CellY + 1);
+		Sample.Weights[0] = CoordX + CoordY - 1.0;
+		Sample.Weights[1] = 1.0 - CoordY;
+		Sample.Weights[2] = 1.0 - CoordX;
+	}
+	else
+	{
+		// 左上角的三角形
+		Sample.Corners[0] = FInt32Point(CellX, CellY);
+		Sample.Corners[1] = FInt32Point(CellX, CellY + 1);
+		Sample.Corners[2] = FInt32Point(CellX + 1, CellY);
+		Sample.Weights[0] = 1.0 - CoordX - CoordY;
+		Sample.Weights[1] = CoordY;
+		Sample.Weights[2] = CoordX;
+	}
+	return Sample;
+}
+
+double FTerrainHeightSampler::GetHeight(FVector2D Pos) const
+{
+	auto Sample = GetTriangle(Pos);
+	double Height = 0.0;
+	for (int32 i = 0; i < 3; ++i)
+	{
+		Height += Sample.Weights[i] * GetVertexHeight(Sample.Tile, Sample.Corners[i].X, Sample.Corners[i].Y);
+	}
+	return Height;
+}
+
+FVector FTerrainHeightSampler::GetNormal(FVector2D Pos) const
+{
+	auto Sample = GetTriangle(Pos);
+	if (Sample.Tile == Tile && !Normals.IsEmpty())
+	{
+		FVector Normal = FVector::ZeroVector;
+		for (int32 i = 0; i < 3; ++i)
+		{
+			Normal += Sample.Weights[i] * Normals[Sample.Corners[i].Y * (Config.XCellNumber + 1) + Sample.Corners[i].X];
+		}
+		return Normal.GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+	}
+
+	FVector Corners[3];
+	for (int32 i = 0; i < 3; ++i)
+	{
+		Corners[i] = FVector(Sample.Corners[i].X * Config.CellSize, Sample.Corners[i].Y * Config.CellSize, GetVertexHeight(Sample.Tile, Sample.Corners[i].X, Sample.Corners[i].Y));
+	}
+	auto Normal = FVector::CrossProduct(Corners[1] - Corners[0], Corners[2] - Corners[0]).GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+	return Normal.Z < 0.0 ? -Normal : Normal;
+}
+
+double FTerrainHeightSampler::GetVertexHeight(FInt32Point VertexTile, int32 X, int32 Y) const
+{
+	if (VertexTile == Tile && !Vertices.IsEmpty())
+	{
+		return Vertices[Y * (Config.XCellNumber + 1) + X].Z;
+	}
+	return Config.GetVertexHeight(VertexTile, X, Y);
+}
+
+namespace CoinTrajectory
+{
+	static FVector GetPositionFromUV(const FWorldGenConfig& Config, const FTerrainHeightSampler& Sampler, FInt32Point Tile, FVector2D UV)
+	{
+		auto Pos = FVector2D((Tile.X + UV.X) * Config.GetTileSizeX(), (Tile.Y + UV.Y) * Config.GetTileSizeY());
+		return FVector(Pos, Sampler.GetHeight(Pos));
+	}
+
+	FVector2D FindTakeoffUV(const FWorldGenConfig& Config, const FCoinTrajectoryParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, double V)
+	{
+		auto StepU = 1.0 / Config.XCellNumber;
+		auto PrevPos = GetPositionFromUV(Config, Sampler, Tile, FVector2D(0, V));
+		auto CurrentPos = GetPositionFromUV(Config, Sampler, Tile, FVector2D(StepU, V));
+		for (auto i = 1; i < Config.XCellNumber - 1; ++i)
+		{
+			auto NextPos = GetPositionFromUV(Config, Sampler, Tile, FVector2D((i + 1) * StepU, V));
+			// 一阶倒数
+			auto dNew = (NextPos.Z - CurrentPos.Z) / Config.CellSize;
+			auto dOld = (CurrentPos.Z - PrevPos.Z) / Config.CellSize;
+			// 二阶导数
+			auto dd = (dNew - dOld) / Config.CellSize;
+			auto Length = FMath::Pow(1 + dNew * dNew, 1.5);
+			// 曲率
+			auto Curvature = dd / Length;
+			auto Final = -Curvature * Params.MaxWalkingSpeed * Params.MaxWalkingSpeed;
+
+			// 此处能够起飞，生成金币路径
+			if (Final > Params.MinTakeoffAcceleration && CurrentPos.Z > PrevPos.Z)
+			{
+				return FVector2D(i * StepU, V);
+			}
+			PrevPos = CurrentPos;
+			CurrentPos = NextPos;
+		}
+		return FVector2D(-1.0, -1.0); // 没有找到合适的生成位置
+	}
+
+	void Integrate(const FCoinTrajectoryParams& Params, const FTerrainHeightSampler& Sampler, FVector StartPos, double StartZVelocity, TArray<FVector>& OutPositions)
+	{
+		OutPositions.Reset();
+		auto CoinPos = StartPos;
+		auto ZVelocity = StartZVelocity;
+		auto DeltaTime = Params.SpawnTimeInterval;
+
+		for (int32 i = 0; i < Params.MaxCoinNumber; ++i)
+		{
+			// 玩家沿 X 轴前进
+			double X = CoinPos.X + Params.MaxWalkingSpeed * DeltaTime;
+			double Y = CoinPos.Y;
+			double Z = CoinPos.Z + ZVelocity * DeltaTime + 0.5 * Params.Gravity * DeltaTime * DeltaTime;
+
+			// 地面的碰撞是异步生成的，因此我们使用高度图直接检查碰撞
+			if (Z < Sampler.GetHeight(FVector2D(X, Y)) + Params.GroundClearance)
+			{
+				break;
+			}
+			CoinPos = FVector(X, Y, Z);
+			OutPositions.Add(CoinPos);
+
+			// 计算下一个时间点的速度
+			ZVelocity = FMath::Max(ZVelocity + Params.Gravity * DeltaTime, Params.ZVelocityInAir);
+		}
+	}
+
+	void PlanGroundTrace(const FWorldGenConfig& Config, const FCoinTrajectoryParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, double V, FSpawnPlan& OutPlan)
+	{
+		OutPlan.Reset();
+		OutPlan.OriginOffsetX = Config.WorldOriginOffset.X;
+
+		auto TakeoffUV = FindTakeoffUV(Config, Params, Sampler, Tile, V);
+		if (TakeoffUV.X < 0.0)
+		{
+			return;
+		}
+		OutPlan.AnchorUV = TakeoffUV;
+
+		// 根据起飞点的坡度计算起飞速度
+		auto StepU = 1.0 / Config.XCellNumber;
+		auto CurrentPos = GetPositionFromUV(Config, Sampler, Tile, TakeoffUV);
+		auto PrevPos = GetPositionFromUV(Config, Sampler, Tile, FVector2D(TakeoffUV.X - StepU, TakeoffUV.Y));
+		auto dOld = (CurrentPos.Z - PrevPos.Z) / Config.CellSize;
+		auto PitchAngle = -FMath::RadiansToDegrees(FMath::Atan(dOld));
+		auto StartZ = URunnerMovementComponent::CalcStartZVelocity(PitchAngle, Params.MaxWalkingSpeed, Params.TakeoffSpeedScale, Params.MaxStartZVelocityInAir);
+
+		Integrate(Params, Sampler, CurrentPos + Params.StartOffset, StartZ, OutPlan.Positions);
+	}
+} // namespace CoinTrajectory
@@ -4,22 +4,25 @@
 #include "DebugBoxSpawner.h"
 #include "DrawDebugHelpers.h"
 
-void ADebugBoxSpawner::SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator)
+bool ADebugBoxSpawner::SpawnBarriers(FBarrierSpawnContext& Context)
 {
+  auto* WorldGenerator = Context.WorldGenerator;
   if (!WorldGenerator)
   {
-    return;
+    return true;
   }
 
-  for (auto& Point : Positions)
+  for (; !Context.IsFinished() && !Context.ShouldYield(); ++Context.Cursor)
   {
     FTransform Transform;
-    GetTransformFromSeed(Transform, Point, Tile, WorldGenerator);
+    GetTransformFromSeed(Transform, Context);
     FVector BoxExtent = FVector(50.0f / 2.0f, 50.0f / 2.0f, 50.0f / 2.0f);
 
     // Spawn a debug box at the calculated position
     DrawDebugBox(WorldGenerator->GetWorld(), Transform.GetTranslation(), BoxExtent, FColor::Red, true, -1.0f, 0, 5.0f);
+    Context.Budget->Consume();
   }
+  return Context.IsFinished();
 }
 
 
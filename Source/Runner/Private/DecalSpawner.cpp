@@ -21,20 +21,25 @@ FRotator ADecalSpawner::GetRotationFromSeed(FRotator Seed) const
   return Result;
 }
 
-void ADecalSpawner::SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator)
+bool ADecalSpawner::SpawnBarriers(FBarrierSpawnContext& Context)
 {
-  TArray<UDecalComponent*> DecalsInTile;
-  DecalsInTile.Reserve(Positions.Num());
+  auto* WorldGenerator = Context.WorldGenerator;
+  auto Tile = Context.Tile;
 
-  for (const RandomPoint& Position : Positions)
+  ensure(Context.bResumed || SpawnedDecals.Find(Tile) == nullptr); // Ensure no existing entry for this tile
+  auto& DecalsInTile = SpawnedDecals.FindOrAdd(Tile);
+  DecalsInTile.Reserve(Context.Positions.Num());
+
+  for (; !Context.IsFinished() && !Context.ShouldYield(); ++Context.Cursor)
   {
+    const RandomPoint Position = Context.Positions[Context.Cursor];
 		// if (!CanSpawnThisBarrier(Tile, Position.UVPos, WorldGenerator))
 		// {
 		// 	continue; // 跳过不允许生成障碍物的区域
 		// }
 
     FTransform Transform;
-    GetTransformFromSeed(Transform, Position, Tile, WorldGenerator);
+    GetTransformFromSeed(Transform, Context);
 
     auto DecalScale = FMath::Lerp(MinDecalScale, MaxDecalScale, Position.Rotation.Pitch);
     Transform.SetScale3D(FVector(DecalScale, DecalScale, DecalScale));
@@ -64,10 +69,9 @@ void ADecalSpawner::SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point
       Sphere->AttachToComponent(Decal, FAttachmentTransformRules::KeepRelativeTransform);
     }
     DecalsInTile.Add(Decal);
+    Context.Budget->Consume();
   }
-  
-  ensure(SpawnedDecals.Find(Tile) == nullptr); // Ensure no existing entry for this tile
-  SpawnedDecals.Add(Tile, MoveTemp(DecalsInTile));  
+  return Context.IsFinished();
 }
 
 void ADecalSpawner::RemoveTile(FInt32Point Tile)
@@ -82,24 +86,15 @@ void ADecalSpawner::RemoveTile(FInt32Point Tile)
 
 void ADecalSpawner::MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX)
 {
-  TMap<FInt32Point, TArray<UDecalComponent*>> NewSpawnedDecals;
-  NewSpawnedDecals.Reserve(SpawnedDecals.Num());
-
-  for (auto& It : SpawnedDecals)
-  {
-    auto NewKey = FInt32Point(It.Key.X - TileXOffset, It.Key.Y);
-    
-    for (UDecalComponent* Decal : It.Value)
+  SpawnedDecals.MoveWorldOrigin(TileXOffset);
+  SpawnedDecals.ForEach([WorldOffsetX](FInt32Point, const TArray<UDecalComponent*>& Decals) {
+    for (UDecalComponent* Decal : Decals)
     {
       FTransform OutInstanceTransform = Decal->GetComponentTransform();
       OutInstanceTransform.SetTranslation(OutInstanceTransform.GetTranslation() - FVector(WorldOffsetX, 0.0, 0.0));
       Decal->SetWorldTransform(OutInstanceTransform);
     }
-
-    NewSpawnedDecals.Add(NewKey, MoveTemp(It.Value));
-  }
-
-  SpawnedDecals = MoveTemp(NewSpawnedDecals);
+  });
 
   for (UDecalComponent* Decal : CachedDecals)
   {
@@ -1,6 +1,10 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "GoldCoinSpawner.h"
+#include "ActorPoolSubsystem.h"
+#include "CoinActor.h"
+#include "CoinFieldComponent.h"
+#include "CoinTrajectory.h"
 #include "DrawDebugHelpers.h"
 #include "Engine/OverlapResult.h"
 #include "Engine/World.h"
@@ -17,10 +21,17 @@
 AGoldCoinSpawner::AGoldCoinSpawner()
 {
 	bDeferSpawn = true; // 默认延迟 spawn
+	CoinField = CreateDefaultSubobject<UCoinFieldComponent>(TEXT("CoinField"));
+	RootComponent = CoinField;
 }
 
 void AGoldCoinSpawner::BeginPlay()
 {
+	// 下面的 RebuildGenConfig 会读取阻挡检测的半径，先从模板初始化
+	// 没有金币模板时按 BarrierRadius 检测，和轨迹离地的距离一致
+	CoinField->SetBlockingTest(BarrierRadius, ECC_WorldStatic);
+	CoinField->InitFromTemplate(BarrierClass ? Cast<ACoinActor>(BarrierClass->GetDefaultObject()) : nullptr);
+	Super::BeginPlay();
 	TActorIterator<AISMBridgeSpawner> It(GetWorld());
 	if (It)
 	{
@@ -49,49 +60,58 @@ void AGoldCoinSpawner::BeginPlay()
 			MaxStartZVelocityInAir = MoveComp->MaxStartZVelocityInAir;
 		}
 	}
-	// 不能缓存金币
-	MaxCachedBarriers = 0;
+	// 运动参数来自玩家，更新 worker 使用的快照
+	TActorIterator<AWorldGenerator> WorldGeneratorIt(GetWorld());
+	if (WorldGeneratorIt && WorldGeneratorIt->HasActorBegunPlay())
+	{
+		WorldGeneratorIt->RebuildGenConfig();
+	}
 }
 
-FVector2D AGoldCoinSpawner::GetCurrentGroundDirection(double time)
+void AGoldCoinSpawner::PrewarmPool(UActorPoolSubsystem& Pool, int32 Count) const
 {
-	// 默认为前方
-	return FVector2D(1, 0);
+	// 金币由 CoinField 渲染，只有云和道具是 actor
+	Pool.Prewarm(CloudClass, ItemPoolSize);
+	for (const auto& ItemClass : Itemclasses)
+	{
+		Pool.Prewarm(ItemClass, ItemPoolSize);
+	}
 }
 
-int32 AGoldCoinSpawner::GenerateGoldTrace(FVector WorldStartPos, double StartYaw, double StartZVelocity, FInt32Point Tile, AWorldGenerator* WorldGenerator, FVector2D RandomSeed)
+FCoinTrajectoryParams AGoldCoinSpawner::GetTrajectoryParams() const
 {
-	FVector CoinPos = WorldStartPos;
-	double ZVelocity = StartZVelocity;
-	double Time = 0.0;
-	int32 CoinNumber = 0;
-
-	for (int32 i = 0; i < MaxCoinNumber; ++i)
-	{
-		// 计算当前位置
-		FVector2D CurrentDirection = GetCurrentGroundDirection(Time);
-		double X = CoinPos.X + MaxWalkingSpeed * SpawnTimeInterval * CurrentDirection.X;
-		double Y = CoinPos.Y + MaxWalkingSpeed * SpawnTimeInterval * CurrentDirection.Y;
-		double Z = CoinPos.Z + ZVelocity * SpawnTimeInterval + 0.5 * Gravity * SpawnTimeInterval * SpawnTimeInterval;
-
-		// DrawDebugBox(GetWorld(), FVector(X, Y, Z), FVector(50, 50, 50), FColor::Yellow, true, 5.0f);
+	FCoinTrajectoryParams Params;
+	Params.MaxWalkingSpeed = MaxWalkingSpeed;
+	Params.ZVelocityInAir = ZVelocityInAir;
+	Params.Gravity = Gravity;
+	Params.TakeoffSpeedScale = TakeoffSpeedScale;
+	Params.MaxStartZVelocityInAir = MaxStartZVelocityInAir;
+	Params.SpawnTimeInterval = SpawnTimeInterval;
+	Params.MaxCoinNumber = MaxCoinNumber;
+	// 离地的距离不小于阻挡检测的半径，否则轨迹会在第一个金币处截断
+	Params.GroundClearance = FMath::Max<double>(BarrierRadius, CoinField->GetBlockingRadius());
+	Params.StartOffset = CoinStartOffset;
+	return Params;
+}
 
-		auto WorldHeight = WorldGenerator->GetVisualHeightFromHorizontalPos(FVector2D(X, Y));
-		// DrawDebugBox(GetWorld(), FVector(X, Y, WorldHeight), FVector(50, 50, 50), FColor::Red, true, 5.0f);
-		// 地面的碰撞是异步生成的，因此我们使用高度图直接检查碰撞
-		if (Z < WorldHeight + BarrierRadius)
-		{
-			// UE_LOG(LogBarrierSpawner, Warning, TEXT("AGoldCoinSpawner::GenerateGoldTrace: Coin Z position %f is below world height %f at (%f, %f), stop generating further coins."), Z, WorldHeight, X, Y);
-			break; // 如果不允许埋地，直接停止生成
-		}
+void AGoldCoinSpawner::FillGenConfig(FSpawnerGenConfig& OutConfig) const
+{
+	Super::FillGenConfig(OutConfig);
+	OutConfig.bPlanTransforms = false; // 只使用地面金币轨迹的规划结果
+	OutConfig.CoinTrajectory = GetTrajectoryParams();
+}
 
-		CoinPos = FVector(X, Y, Z);
+int32 AGoldCoinSpawner::SpawnGoldTrace(TConstArrayView<FVector> Positions, FVector Shift, double StartYaw, FInt32Point Tile, AWorldGenerator* WorldGenerator, FVector2D RandomSeed)
+{
+	int32 CoinNumber = 0;
+	auto CoinRotation = FRotator(0, StartYaw, 0);
+	auto ItemPos = FVector::ZeroVector;
+	auto bGenerateCloud = false;
+	for (int32 i = 0; i < Positions.Num(); ++i)
+	{
+		auto CoinPos = Positions[i] + Shift;
 
 		// 生成金币
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::DontSpawnIfColliding;
-
-		auto BarrierToSpawn = BarrierClass;
 		auto ItemNumber = -1;
 		if (i == ItemAppearNumber)
 		{
@@ -99,7 +119,6 @@ int32 AGoldCoinSpawner::GenerateGoldTrace(FVector WorldStartPos, double StartYaw
 			if (bItemAppear)
 			{
 				ItemNumber = FMath::Clamp(FMath::FloorToInt32(RandomSeed.Y * Itemclasses.Num()), 0, Itemclasses.Num() - 1);
-				BarrierToSpawn = Itemclasses[ItemNumber];
 			}
 		}
 		// 检查 special laser 的位置，看生成云是否合适
@@ -107,44 +126,64 @@ int32 AGoldCoinSpawner::GenerateGoldTrace(FVector WorldStartPos, double StartYaw
 
 		if (ItemNumber == 0 && !CanGenerateCloudTrace(WorldGenerator, CoinPos.X / (WorldGenerator->CellSize * WorldGenerator->XCellNumber)))
 		{
-			BarrierToSpawn = BarrierClass; // 如果不能生成云，则使用默认的金币类
-			ItemNumber = -1;
+			ItemNumber = -1; // 如果不能生成云，则生成金币
 		}
 
-		auto* CoinActor = GetWorld()->SpawnActor<AActor>(BarrierToSpawn, CoinPos, FRotator(0, StartYaw, 0), SpawnParams);
-		if (CoinActor)
+		// 和阻挡的几何体重叠时不生成，轨迹在这里截断
+		if (ItemNumber >= 0)
 		{
-			// DrawDebugBox(GetWorld(), CoinPos, FVector(50, 50, 50), FColor::Green, true, 10.0f);
-			SpawnedBarriers.Add(Tile, CoinActor);
-			CoinNumber++;
+			if (!AcquireBarrier(Itemclasses[ItemNumber], FTransform(CoinRotation, CoinPos), Tile, true))
+			{
+				break;
+			}
 		}
-		else
+		else if (CoinField->IsBlocked(CoinPos))
 		{
-			// UE_LOG(LogBarrierSpawner, Warning, TEXT("AGoldCoinSpawner::GenerateGoldTrace: Failed to spawn coin at %s"), *CoinPos.ToString());
+			// UE_LOG(LogBarrierSpawner, Warning, TEXT("AGoldCoinSpawner::SpawnGoldTrace: Failed to spawn coin at %s"), *CoinPos.ToString());
 			break;
 		}
+		else
+		{
+			// DrawDebugBox(GetWorld(), CoinPos, FVector(50, 50, 50), FColor::Green, true, 10.0f);
+			PendingCoins.Add(CoinField->MakeCoinTransform(CoinRotation, CoinPos));
+		}
+		CoinNumber++;
 		// 处理云的生成
 		if (ItemNumber == 0)
 		{
-			GenerateCloudTrace(CoinPos, Tile);
+			ItemPos = CoinPos;
+			bGenerateCloud = true;
 			break; // 云生成后，停止生成后续的金币
 		}
-
-		// 计算下一个时间点的速度
-		double NextTime = Time + SpawnTimeInterval;
-		double NextZVelocity = ZVelocity + Gravity * SpawnTimeInterval;
-
-		NextZVelocity = FMath::Max(NextZVelocity, ZVelocityInAir);
-
-		Time = NextTime;
-		ZVelocity = NextZVelocity;
+	}
+	CoinField->AddCoins(PendingCoins, SpawnedCoins.FindOrAdd(Tile));
+	if (bGenerateCloud)
+	{
+		GenerateCloudTrace(ItemPos, Tile);
 	}
 	return CoinNumber;
 }
 
-void AGoldCoinSpawner::SpawnDeferredBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, FVector2D UVPos, AWorldGenerator* WorldGenerator)
+void AGoldCoinSpawner::RemoveTile(FInt32Point Tile)
+{
+	Super::RemoveTile(Tile);
+	if (auto* CoinIndices = SpawnedCoins.Find(Tile))
+	{
+		CoinField->RemoveCoins(*CoinIndices);
+		SpawnedCoins.Remove(Tile); // 保留数组的容量给之后的 tile
+	}
+}
+
+void AGoldCoinSpawner::MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX)
+{
+	Super::MoveWorldOrigin(TileXOffset, WorldOffsetX);
+	SpawnedCoins.MoveWorldOrigin(TileXOffset);
+	CoinField->MoveWorldOrigin(WorldOffsetX);
+}
+
+void AGoldCoinSpawner::SpawnDeferredBarriers(FSpawnSeedView Positions, FInt32Point Tile, const FSpawnPlan& Plan, AWorldGenerator* WorldGenerator)
 {
-	if (!WorldGenerator || !BarrierClass || !BridgeSpawner)
+	if (!WorldGenerator || !BridgeSpawner)
 	{
 		return;
 	}
@@ -154,11 +193,8 @@ void AGoldCoinSpawner::SpawnDeferredBarriers(TArrayView<RandomPoint> Positions,
 		return;
 	}
 
-	TArray<bool> UsedInstances;
-	UsedInstances.SetNumZeroed(Instances->Num());
-
-	TArrayView<RandomPoint> PosBridge;
-	TArrayView<RandomPoint> PosGround;
+	FSpawnSeedView PosBridge;
+	FSpawnSeedView PosGround;
 	ensure(Positions.Num() == 2);
 	if (Positions.Num() > 1)
 	{
@@ -170,20 +206,26 @@ void AGoldCoinSpawner::SpawnDeferredBarriers(TArrayView<RandomPoint> Positions,
 		PosBridge = Positions;
 	}
 
-	// 生成桥上的金币
+	// 生成桥上的金币，桥的实例只在 game 线程上可见，这里用快照中的地形直接积分
+	auto Params = GetTrajectoryParams();
+	auto Config = WorldGenerator->GetGenConfig();
+	FTerrainHeightSampler Sampler(*Config);
+	auto* BridgeComponent = BridgeSpawner->GetComponentInTile(Tile);
 	int32 FinalInstanceIndex = 0;
-	for (auto& Point : PosBridge)
+	for (int32 PointIndex = 0; PointIndex < PosBridge.Num(); ++PointIndex)
 	{
+		auto Point = PosBridge[PointIndex];
 		auto CoinRotator = GetRotationFromSeed(Point.Rotation);
 
-		auto SlopeAngle = BridgeSpawner->GetCustomSlopeAngle(Instances->operator[](FinalInstanceIndex));
+		auto SlopeAngle = BridgeSpawner->GetCustomSlopeAngle(BridgeComponent, Instances->operator[](FinalInstanceIndex));
 		FTransform InstanceTransform;
-		BridgeSpawner->ISMComponent->GetInstanceTransform(Instances->operator[](FinalInstanceIndex), InstanceTransform, true);
+		BridgeComponent->GetInstanceTransform(Instances->operator[](FinalInstanceIndex), InstanceTransform, true);
 
 		auto CoinStartPos = InstanceTransform.TransformPosition(CoinStartOffset);
 		auto StartZ = URunnerMovementComponent::CalcStartZVelocity(SlopeAngle, MaxWalkingSpeed, TakeoffSpeedScale, MaxStartZVelocityInAir);
 
-		GenerateGoldTrace(CoinStartPos, CoinRotator.Yaw, StartZ, Tile, WorldGenerator, FVector2D(Point.Rotation.Pitch, Point.Rotation.Roll));
+		CoinTrajectory::Integrate(Params, Sampler, CoinStartPos, StartZ, BridgeTracePositions);
+		SpawnGoldTrace(BridgeTracePositions, FVector::ZeroVector, CoinRotator.Yaw, Tile, WorldGenerator, FVector2D(Point.Rotation.Pitch, Point.Rotation.Roll));
 		++FinalInstanceIndex;
 		if (FinalInstanceIndex >= Instances->Num())
 		{
@@ -191,82 +233,30 @@ void AGoldCoinSpawner::SpawnDeferredBarriers(TArrayView<RandomPoint> Positions,
 		}
 	}
 
-	// 生成地面上的金币
-	if (UVPos.X >= 0.0 && UVPos.Y >= 0.0)
+	// 生成地面上的金币，轨迹已经在 worker 上规划好
+	if (Plan.IsValid() && PosGround.Num() > 0)
 	{
-		auto StepU = 1.0 / WorldGenerator->XCellNumber;
-		auto CoinRotator = GetRotationFromSeed(PosGround[0].Rotation);
-		auto CurrentUV = FVector2D(UVPos);
-		auto PrevUV = FVector2D(CurrentUV.X - StepU, CurrentUV.Y);
-		auto CurrentPos = WorldGenerator->GetVisualWorldPositionFromUV(CurrentUV, Tile);
-		auto PrevPos = WorldGenerator->GetVisualWorldPositionFromUV(PrevUV, Tile);
-
-		auto dOld = (CurrentPos.Z - PrevPos.Z) / WorldGenerator->CellSize;
-
-		auto StartPos = CurrentPos + CoinStartOffset;
-		auto PitchAngle = -FMath::RadiansToDegrees(FMath::Atan(dOld));
-		auto StartZ = URunnerMovementComponent::CalcStartZVelocity(PitchAngle, MaxWalkingSpeed, TakeoffSpeedScale, MaxStartZVelocityInAir);
-		auto GeneratedNumber = GenerateGoldTrace(StartPos, CoinRotator.Yaw, StartZ, Tile, WorldGenerator, FVector2D(PosGround[0].Rotation.Pitch, PosGround[0].Rotation.Roll));
-		// UE_LOG(LogBarrierSpawner, Log, TEXT("AGoldCoinSpawner::SpawnBarriers: Generated gold trace at %s, PitchAngle %f, StartZ: %f, GenerateNumber: %d"), *StartPos.ToString(), -PitchAngle, StartZ, GeneratedNumber);
-		if (GeneratedNumber > 0)
-		{
-			// DrawDebugBox(GetWorld(), StartPos, FVector(300, 300, 300), FColor::Yellow, true, 5.0f);
-		}
+		auto GroundPoint = PosGround[0];
+		auto CoinRotator = GetRotationFromSeed(GroundPoint.Rotation);
+		SpawnGoldTrace(Plan.Positions, Plan.GetOriginShift(WorldGenerator->WorldOriginOffset.X), CoinRotator.Yaw, Tile, WorldGenerator, FVector2D(GroundPoint.Rotation.Pitch, GroundPoint.Rotation.Roll));
 	}
 }
 
-FVector2D AGoldCoinSpawner::PreSpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator)
+FVector2D AGoldCoinSpawner::PreSpawnBarriers(FSpawnSeedView Positions, FInt32Point Tile, const FSpawnPlan& Plan, AWorldGenerator* WorldGenerator)
 {
-	ensure(Positions.Num() == 2);
-	TArrayView<RandomPoint> PosGround;
-	PosGround = Positions.Slice(Positions.Num() - 1, 1);
-
-	// 生成地面上的金币
-	auto YSize = double(WorldGenerator->YCellNumber) * WorldGenerator->CellSize;
-	auto StepU = 1.0 / WorldGenerator->XCellNumber;
-	for (auto& Point : PosGround)
-	{
-		auto CoinRotator = GetRotationFromSeed(Point.Rotation);
-		auto StartY = Point.UVPos.Y * YSize;
-
-		auto PrevPos = WorldGenerator->GetVisualWorldPositionFromUV(FVector2D(0, Point.UVPos.Y), Tile);
-		auto CurrentPos = WorldGenerator->GetVisualWorldPositionFromUV(FVector2D(StepU, Point.UVPos.Y), Tile);
-		auto NextPos = FVector::ZeroVector;
-		for (auto i = 1; i < WorldGenerator->XCellNumber - 1; ++i)
-		{
-			NextPos = WorldGenerator->GetVisualWorldPositionFromUV(FVector2D((i + 1) * StepU, Point.UVPos.Y), Tile);
-			// 一阶倒数
-			auto dNew = (NextPos.Z - CurrentPos.Z) / WorldGenerator->CellSize;
-			auto dOld = (CurrentPos.Z - PrevPos.Z) / WorldGenerator->CellSize;
-			// 二阶导数
-			auto dd = (dNew - dOld) / WorldGenerator->CellSize;
-			auto Length = FMath::Pow(1 + dNew * dNew, 1.5);
-			// 曲率
-			auto Curvature = dd / Length;
-			auto Final = -Curvature * MaxWalkingSpeed * MaxWalkingSpeed;
-
-			// 此处能够起飞，生成金币路径
-			// TODO: 把常数替换掉
-			if (Final > 1000.0 && CurrentPos.Z > PrevPos.Z)
-			{
-				auto CurrentUV = FVector2D(i * StepU, Point.UVPos.Y);
-				return CurrentUV;
-			}
-			PrevPos = CurrentPos;
-			CurrentPos = NextPos;
-		}
-	}
-	return FVector2D(-1.0, -1.0); // 没有找到合适的生成位置
+	// 起飞点在 worker 上找好了，这里只需要为它预留位置
+	return Plan.AnchorUV;
 }
 
-bool AGoldCoinSpawner::DeferSpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, FVector2D UVPos, AWorldGenerator* WorldGenerator)
+bool AGoldCoinSpawner::DeferSpawnBarriers(FSpawnSeedView Positions, FInt32Point Tile, const FSpawnPlan& Plan, AWorldGenerator* WorldGenerator, FInt32Point& OutMissingTile)
 {
-	auto DepentTile = FInt32Point(Tile.X + 1, Tile.Y);
+	auto DepentTile = GetDeferredSpawnDependency(Tile);
 	if (!WorldGenerator->IsValidTile(DepentTile))
 	{
+		OutMissingTile = DepentTile;
 		return false;
 	}
-	SpawnDeferredBarriers(Positions, Tile, UVPos, WorldGenerator);
+	SpawnDeferredBarriers(Positions, Tile, Plan, WorldGenerator);
 	return true;
 }
 
@@ -299,20 +289,21 @@ void AGoldCoinSpawner::GenerateCloudTrace(FVector ItemPos, FInt32Point Tile)
 		if (OverlappedActor && ClassToRemoveWhenOverlap.Contains(OverlappedActor->GetClass()))
 		{
 			UE_LOG(LogBarrierSpawner, Log, TEXT("AGoldCoinSpawner::GenerateCloudTrace: Remove overlapping actor %s at %s"), *OverlappedActor->GetName(), *OverlappedActor->GetActorLocation().ToString());
-			OverlappedActor->Destroy();
+			// actor 仍然属于生成它的 spawner，tile 移除时放回对象池
+			UActorPoolSubsystem::Park(OverlappedActor);
 		}
 	}
 	// DrawDebugBox(GetWorld(), CloudPos, BoxExtent, FColor::Blue, true, 5.0f);
 
-	auto CloudActor = GetWorld()->SpawnActor<AActor>(CloudClass, CloudPos, FRotator::ZeroRotator);
 	// 云和金币匿属于下一个 Tile
-	SpawnedBarriers.Add(FInt32Point(Tile.X + 1, Tile.Y), CloudActor);
+	auto NextTile = FInt32Point(Tile.X + 1, Tile.Y);
+	AcquireBarrier(CloudClass, FTransform(CloudPos), NextTile);
 	auto CurrentCoinPos = CloudPos + CoinOffsetInCloud;
 	auto Offset = MaxWalkingSpeed * SpawnTimeInterval;
 	for (auto i = 0; i < CoinNumberInCloud; ++i)
 	{
-		auto CoinActor = GetWorld()->SpawnActor<AActor>(BarrierClass, CurrentCoinPos, FRotator::ZeroRotator);
-		SpawnedBarriers.Add(FInt32Point(Tile.X + 1, Tile.Y), CoinActor);
+		PendingCoins.Add(CoinField->MakeCoinTransform(FRotator::ZeroRotator, CurrentCoinPos));
 		CurrentCoinPos.X += Offset;
 	}
+	CoinField->AddCoins(PendingCoins, SpawnedCoins.FindOrAdd(NextTile));
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "Math/MathFwd.h"
 #include "Misc/AssertionMacros.h"
 #include "Templates/UnrealTemplate.h"
+#include "TimerManager.h"
 
 AISMBarrierSpawner::AISMBarrierSpawner()
 {
@@ -16,42 +17,72 @@ AISMBarrierSpawner::AISMBarrierSpawner()
 	ISMComponent->bReceivesDecals = false; // 不接收 decal
 }
 
-void AISMBarrierSpawner::SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator)
+void AISMBarrierSpawner::BeginPlay()
 {
-	if (!ISMComponent || !WorldGenerator)
+	Super::BeginPlay();
+	// 开启 HISM 时 ISMComponent 会换成新建的组件，之后 ISMComponent 同时是 tile 组件的模板
+	ISMComponent = RenderSettings.ApplyTo(this, ISMComponent);
+	if (CompactInterval > 0.0f && !bComponentPerTile)
+	{
+		GetWorldTimerManager().SetTimer(CompactTimerHandle, this, &AISMBarrierSpawner::CompactInstances, CompactInterval, true);
+	}
+}
+
+void AISMBarrierSpawner::CompactInstances()
+{
+	if (!ISMComponent)
+	{
+		return;
+	}
+	if (!PendingInstances.Compact(ISMComponent, ReplaceInstanceIndices, MaxCompactMovesPerFrame, CompactRemap))
+	{
+		// 空洞太多，下一帧继续，避免一帧内移动所有实例
+		GetWorldTimerManager().SetTimerForNextTick(this, &AISMBarrierSpawner::CompactInstances);
+	}
+	if (CompactRemap.IsEmpty())
 	{
 		return;
 	}
+	++InstanceRemapSerial;
+	TileInstanceIndices.ForEach([this](FInt32Point, TArray<int32>& InstanceIndices) {
+		for (auto& InstanceIndex : InstanceIndices)
+		{
+			if (const auto* NewIndex = CompactRemap.Find(InstanceIndex))
+			{
+				InstanceIndex = *NewIndex;
+			}
+		}
+	});
+}
 
-	TArray<int32> InstanceIndices;
-	InstanceIndices.Reserve(Positions.Num());
-	for (auto& Point : Positions)
+bool AISMBarrierSpawner::SpawnBarriers(FBarrierSpawnContext& Context)
+{
+	auto* WorldGenerator = Context.WorldGenerator;
+	auto Tile = Context.Tile;
+	if (!ISMComponent || !WorldGenerator)
 	{
+		return true;
+	}
+
+	ensure(Context.bResumed || TileInstanceIndices.Find(Tile) == nullptr); // Ensure no existing entry for this tile
+	auto& InstanceIndices = TileInstanceIndices.FindOrAdd(Tile);
+	InstanceIndices.Reserve(Context.Positions.Num());
+	for (; !Context.IsFinished() && !Context.ShouldYield(); ++Context.Cursor)
+	{
+		auto Point = Context.Positions[Context.Cursor];
 		if (!CanSpawnThisBarrier(Tile, Point.UVPos, WorldGenerator))
 		{
 			continue; // 跳过不允许生成障碍物的区域
 		}
 		FTransform Transform;
-		GetTransformFromSeed(Transform, Point, Tile, WorldGenerator);
+		GetTransformFromSeed(Transform, Context);
 
-		if (ReplaceInstanceIndices.Num() > 0)
-		{
-			// Reuse an existing instance index if available
-			// Transform.SetScale3D(FVector(Point.Size));
-			int32 InstanceIndex = ReplaceInstanceIndices.Pop(EAllowShrinking::No);
-			ISMComponent->UpdateInstanceTransform(InstanceIndex, Transform, true, false, true);
-			InstanceIndices.Add(InstanceIndex);
-		}
-		else
-		{
-			// Add a new instance
-			InstanceIndices.Add(ISMComponent->AddInstance(Transform, true));
-		}
+		PendingInstances.Add(Transform);
+		Context.Budget->Consume();
 	}
-	// 在最后统一标记 render state 为 dirty
-	ISMComponent->MarkRenderStateDirty();
-	ensure(TileInstanceIndices.Find(Tile) == nullptr); // Ensure no existing entry for this tile
-	TileInstanceIndices.Add(Tile, MoveTemp(InstanceIndices));
+	// 这一帧生成的实例一次性提交，优先复用已移除 tile 的实例
+	PendingInstances.Commit(AcquireTileComponent(Tile), ReplaceInstanceIndices, InstanceIndices);
+	return Context.IsFinished();
 }
 
 void AISMBarrierSpawner::RemoveTile(FInt32Point Tile)
@@ -59,41 +90,72 @@ void AISMBarrierSpawner::RemoveTile(FInt32Point Tile)
 	auto InstanceIndices = TileInstanceIndices.Find(Tile);
 	if (InstanceIndices)
 	{
-		ReplaceInstanceIndices.Append(*InstanceIndices);
+		// 单独组件的实例随组件一起回收
+		if (!bComponentPerTile)
+		{
+			// 立即隐藏，不要等到之后的 tile 复用
+			FISMInstanceBatch::HideInstances(ISMComponent, *InstanceIndices);
+			ReplaceInstanceIndices.Append(*InstanceIndices);
+		}
 		TileInstanceIndices.Remove(Tile);
 	}
+	ReleaseTileComponent(Tile);
 }
 
 void AISMBarrierSpawner::MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX)
 {
-	TMap<FInt32Point, TArray<int32>> NewTileInstanceIndices;
-	NewTileInstanceIndices.Reserve(TileInstanceIndices.Num());
-	for (auto& It : TileInstanceIndices)
-	{
-		auto NewKey = FInt32Point(It.Key.X - TileXOffset, It.Key.Y);
+	TileInstanceIndices.MoveWorldOrigin(TileXOffset);
+	// 所有实例要么属于某个 tile，要么在 ReplaceInstanceIndices 中（已隐藏），一起平移，只需要一次提交
+	FISMInstanceBatch::OffsetAllInstances(ISMComponent, FVector(-WorldOffsetX, 0.0, 0.0));
 
-		for (int32 InstanceIndex : It.Value)
-		{
-			FTransform OutInstanceTransform;
-			// 我们假设 ISM 的 transfrom 一直是原点，因此这里 bWorldSpace 为 false，避免矩阵乘法
-			ISMComponent->GetInstanceTransform(InstanceIndex, OutInstanceTransform, false);
-			OutInstanceTransform.SetTranslation(OutInstanceTransform.GetTranslation() - FVector(WorldOffsetX, 0.0, 0.0));
-			ISMComponent->UpdateInstanceTransform(InstanceIndex, OutInstanceTransform, false, false, true);
-		}
+	// tile 组件只需要移动组件本身，空闲的组件没有实例，不需要处理
+	TileComponents.MoveWorldOrigin(TileXOffset);
+	TileComponents.ForEach([WorldOffsetX](FInt32Point, UInstancedStaticMeshComponent* Component) {
+		Component->AddWorldOffset(FVector(-WorldOffsetX, 0.0, 0.0));
+	});
+}
 
-		NewTileInstanceIndices.Add(NewKey, MoveTemp(It.Value));
+UInstancedStaticMeshComponent* AISMBarrierSpawner::GetComponentInTile(FInt32Point Tile) const
+{
+	auto* Component = TileComponents.Find(Tile);
+	return Component ? *Component : ISMComponent;
+}
+
+UInstancedStaticMeshComponent* AISMBarrierSpawner::AcquireTileComponent(FInt32Point Tile)
+{
+	if (!bComponentPerTile)
+	{
+		return ISMComponent;
+	}
+	auto*& Component = TileComponents.FindOrAdd(Tile);
+	if (Component)
+	{
+		return Component; // 这个 tile 的 spawn 跨帧继续
+	}
+
+	if (FreeTileComponents.Num() > 0)
+	{
+		Component = FreeTileComponents.Pop(EAllowShrinking::No);
+		Component->SetRelativeTransform(FTransform::Identity);
+		Component->SetVisibility(true);
+		return Component;
 	}
 
-	TileInstanceIndices = MoveTemp(NewTileInstanceIndices);
+	// 复制 ISMComponent 的设置，组件需要是 Movable 才能在移动原点时平移
+	Component = RenderSettings.CreateComponent(this, ISMComponent, EComponentMobility::Movable);
+	TileComponentPool.Add(Component);
+	return Component;
+}
 
-	// TODO：是否需要处理 ReplaceInstanceIndices？
-	for (int32 InstanceIndex : ReplaceInstanceIndices)
+void AISMBarrierSpawner::ReleaseTileComponent(FInt32Point Tile)
+{
+	UInstancedStaticMeshComponent* Component = nullptr;
+	if (!TileComponents.RemoveAndCopyValue(Tile, Component))
 	{
-		FTransform OutInstanceTransform;
-		// 我们假设 ISM 的 transfrom 一直是原点，因此这里 bWorldSpace 为 false，避免矩阵乘法
-		ISMComponent->GetInstanceTransform(InstanceIndex, OutInstanceTransform, false);
-		OutInstanceTransform.SetTranslation(OutInstanceTransform.GetTranslation() - FVector(WorldOffsetX, 0.0, 0.0));
-		ISMComponent->UpdateInstanceTransform(InstanceIndex, OutInstanceTransform, false, false, true);
+		return;
 	}
-	ISMComponent->MarkRenderStateDirty();
-}
\ No newline at end of file
+	// 一次清空整个组件，之后的 tile 重新添加实例
+	Component->ClearInstances();
+	Component->SetVisibility(false);
+	FreeTileComponents.Add(Component);
+}
@@ -16,52 +16,54 @@ FRotator AISMBridgeSpawner::GetRotationFromSeed(FRotator Seed) const
 	return Rotation;
 }
 
-void AISMBridgeSpawner::SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator)
+bool AISMBridgeSpawner::SpawnBarriers(FBarrierSpawnContext& Context)
 {
+	auto* WorldGenerator = Context.WorldGenerator;
+	auto Tile = Context.Tile;
 	if (!ISMComponent || !WorldGenerator)
 	{
-		return;
+		return true;
 	}
 
-	TArray<int32> InstanceIndices;
-	InstanceIndices.Reserve(Positions.Num());
-	for (auto& Point : Positions)
+	ensure(Context.bResumed || TileInstanceIndices.Find(Tile) == nullptr); // Ensure no existing entry for this tile
+	auto& InstanceIndices = TileInstanceIndices.FindOrAdd(Tile);
+	InstanceIndices.Reserve(Context.Positions.Num());
+	for (; !Context.IsFinished() && !Context.ShouldYield(); ++Context.Cursor)
 	{
+		auto Point = Context.Positions[Context.Cursor];
 		if (!CanSpawnThisBarrier(Tile, Point.UVPos, WorldGenerator))
 		{
 			continue; // 跳过不允许生成障碍物的区域
 		}
 
 		FTransform Transform;
-		GetTransformFromSeed(Transform, Point, Tile, WorldGenerator);
-		auto Rotator = Transform.GetRotation().Rotator();
-		Rotator.Pitch = FMath::Min(Rotator.Pitch, MaxBridgeAngle);
-		Transform.SetRotation(Rotator.Quaternion());
+		// 俯仰角已经在 worker 上限制到 MaxBridgeAngle
+		GetTransformFromSeed(Transform, Context);
 
-		if (ReplaceInstanceIndices.Num() > 0)
-		{
-			// Reuse an existing instance index if available
-			// Transform.SetScale3D(FVector(Point.Size));
-			int32 InstanceIndex = ReplaceInstanceIndices.Pop(EAllowShrinking::No);
-			ISMComponent->UpdateInstanceTransform(InstanceIndex, Transform, true, false, true);
-			InstanceIndices.Add(InstanceIndex);
-		}
-		else
-		{
-			// Add a new instance
-			InstanceIndices.Add(ISMComponent->AddInstance(Transform, true));
-		}
+		PendingInstances.Add(Transform);
+		Context.Budget->Consume();
 	}
-	// 在最后统一标记 render state 为 dirty
-	ISMComponent->MarkRenderStateDirty();
-	ensure(TileInstanceIndices.Find(Tile) == nullptr); // Ensure no existing entry for this tile
-	TileInstanceIndices.Add(Tile, MoveTemp(InstanceIndices));
+	// 这一帧生成的实例一次性提交，优先复用已移除 tile 的实例
+	PendingInstances.Commit(AcquireTileComponent(Tile), ReplaceInstanceIndices, InstanceIndices);
+	return Context.IsFinished();
 }
 
-double AISMBridgeSpawner::GetCustomSlopeAngle(int32 InstanceIndex) const
+void AISMBridgeSpawner::FillGenConfig(FSpawnerGenConfig& OutConfig) const
 {
+	Super::FillGenConfig(OutConfig);
+	OutConfig.Transform.MaxPitch = MaxBridgeAngle;
+}
+
+double AISMBridgeSpawner::GetCustomSlopeAngle(const UPrimitiveComponent* Component, int32 InstanceIndex) const
+{
+	// 开启 bComponentPerTile 时实例在各个 tile 的组件中
+	auto* InstanceComponent = Cast<UInstancedStaticMeshComponent>(Component);
+	if (!InstanceComponent)
+	{
+		InstanceComponent = ISMComponent;
+	}
 	FTransform Transform;
-	ISMComponent->GetInstanceTransform(InstanceIndex, Transform);
+	InstanceComponent->GetInstanceTransform(InstanceIndex, Transform);
 
 	auto PitchAngle = Transform.GetRotation().Rotator().Pitch;
 	return -PitchAngle;
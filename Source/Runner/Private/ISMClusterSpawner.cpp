@@ -5,6 +5,7 @@
 #include "GameFramework/Actor.h"
 #include "Math/MathFwd.h"
 #include "Templates/UnrealTemplate.h"
+#include "TimerManager.h"
 #include "UObject/UnrealType.h"
 
 AISMClusterSpawner::AISMClusterSpawner()
@@ -34,112 +35,137 @@ AISMClusterSpawner::AISMClusterSpawner()
 void AISMClusterSpawner::BeginPlay()
 {
 	Super::BeginPlay();
+	for (auto& ISMComponent : ISMComponents)
+	{
+		ISMComponent = RenderSettings.ApplyTo(this, ISMComponent);
+	}
 	ReplaceInstanceIndices.SetNum(ISMComponents.Num());
+	PendingInstances.SetNum(ISMComponents.Num());
+	if (CompactInterval > 0.0f)
+	{
+		GetWorldTimerManager().SetTimer(CompactTimerHandle, this, &AISMClusterSpawner::CompactInstances, CompactInterval, true);
+	}
 }
 
-// TODO: 这里用到了 unreal 的随机函数，破坏了可复现性
-void AISMClusterSpawner::SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator)
+void AISMClusterSpawner::CompactInstances()
 {
-	TArray<FInt32Point> InstanceIndices;
-	int32 Idx = 0;
-
-	int32 XSize = WorldGenerator->CellSize * WorldGenerator->XCellNumber;
-	int32 YSize = WorldGenerator->CellSize * WorldGenerator->YCellNumber;
-
-	auto IsValidPos = [XSize, YSize, MinDist = this->MinDistanceWithinCluster](FVector2D Pos, const TInlineComponentArray<FVector2D, 8>& PlacedPos) {
-		if (Pos.X < 0 || Pos.X >= XSize || Pos.Y < 0 || Pos.Y >= YSize)
+	auto RemainingMoves = MaxCompactMovesPerFrame;
+	auto bFinished = true;
+	for (int32 MeshIndex = 0; MeshIndex < ISMComponents.Num(); ++MeshIndex)
+	{
+		if (RemainingMoves <= 0)
 		{
-			return false;
+			bFinished = false;
+			break;
 		}
-		for (const auto& Other : PlacedPos)
+		bFinished &= PendingInstances[MeshIndex].Compact(ISMComponents[MeshIndex], ReplaceInstanceIndices[MeshIndex], RemainingMoves, CompactRemap);
+		if (CompactRemap.IsEmpty())
 		{
-			if (FVector2D::DistSquared(Pos, Other) < FMath::Square(MinDist))
+			continue;
+		}
+		RemainingMoves -= CompactRemap.Num();
+		++InstanceRemapSerial;
+		TileInstanceIndices.ForEach([this, MeshIndex](FInt32Point, TArray<FInt32Point>& InstanceIndices) {
+			for (auto& Pair : InstanceIndices)
 			{
-				return false;
+				const auto* NewIndex = Pair.Y == MeshIndex ? CompactRemap.Find(Pair.X) : nullptr;
+				if (NewIndex)
+				{
+					Pair.X = *NewIndex;
+				}
 			}
-		}
+		});
+	}
+	if (!bFinished)
+	{
+		// 空洞太多，下一帧继续，避免一帧内移动所有实例
+		GetWorldTimerManager().SetTimerForNextTick(this, &AISMClusterSpawner::CompactInstances);
+	}
+}
+
+void AISMClusterSpawner::FillGenConfig(FSpawnerGenConfig& OutConfig) const
+{
+	Super::FillGenConfig(OutConfig);
+	OutConfig.bPlanTransforms = false; // 只使用簇成员的 transform
+	auto& Layout = OutConfig.ClusterLayout.Emplace();
+	Layout.MinMeshCount = MinMeshCountInCluster;
+	Layout.MaxMeshCount = MaxMeshCountInCluster;
+	Layout.MinDistance = MinDistanceWithinCluster;
+	Layout.HalfExtent = HalfClusterExtent;
+	Layout.TryTimes = TryTimeBeforeGiveUp;
+	Layout.MeshNumber = ISMComponents.Num();
+}
+
+bool AISMClusterSpawner::SpawnBarriers(FBarrierSpawnContext& Context)
+{
+	auto* WorldGenerator = Context.WorldGenerator;
+	auto Tile = Context.Tile;
+	// 簇的布局、网格体和 transform 都已经在 worker 上算好，这里只需要提交
+	const auto* Plan = Context.Plan;
+	if (!Plan || !ensure(Plan->HasInstances(Context.Positions.Num())))
+	{
 		return true;
-	};
+	}
 
-	for (auto& Point : Positions)
+	ensure(Context.bResumed || TileInstanceIndices.Find(Tile) == nullptr); // Ensure no existing entry for this tile
+	auto& InstanceIndices = TileInstanceIndices.FindOrAdd(Tile);
+	auto OriginShift = Plan->GetOriginShift(WorldGenerator->WorldOriginOffset.X);
+
+	for (; !Context.IsFinished() && !Context.ShouldYield(); ++Context.Cursor)
 	{
+		auto Point = Context.Positions[Context.Cursor];
 		if (!CanSpawnThisBarrier(Tile, Point.UVPos, WorldGenerator))
 		{
 			continue; // 跳过不允许生成障碍物的区域
 		}
-		auto MeshCountInCluster = FMath::RandRange(MinMeshCountInCluster, MaxMeshCountInCluster);
-
-		auto TilePos = FVector2D(Point.UVPos.X * XSize, Point.UVPos.Y * YSize);
-
-		TInlineComponentArray<FVector2D, 8> PlacedPos;
-		PlacedPos.Add(TilePos);
-
-		for (int32 i = 1; i < MeshCountInCluster; ++i)
+		auto Instances = Plan->GetInstances(Context.Cursor);
+		for (const auto& Instance : Instances)
 		{
-			int32 TryNumber = 0;
-			while (TryNumber < TryTimeBeforeGiveUp)
-			{
-				auto X = FMath::FRandRange(-1.0, 1.0);
-				auto Y = FMath::FRandRange(-1.0, 1.0);
-				auto NewPos = TilePos + FVector2D(X, Y) * HalfClusterExtent;
-				if (!IsValidPos(NewPos, PlacedPos))
-				{
-					// 超出边界，重新尝试
-					++TryNumber;
-					continue;
-				}
-				else
-				{
-					PlacedPos.Add(NewPos);
-					break;
-				}
-			}
-			if (TryNumber >= TryTimeBeforeGiveUp)
+			if (!PendingInstances.IsValidIndex(Instance.MeshIndex))
 			{
-				UE_LOG(LogBarrierSpawner, Warning, TEXT("ISMClusterSpawner: Failed to place enough meshes in cluster at tile %s"), *Tile.ToString());
-				break;
+				continue; // 规划之后 ISMComponents 被修改过
 			}
+			auto Transform = Instance.Transform;
+			Transform.AddToTranslation(OriginShift);
+			PendingInstances[Instance.MeshIndex].Add(Transform);
 		}
+		Context.Budget->Consume(Instances.Num());
+	}
 
-		for (auto Pos : PlacedPos)
+	// 每个 ISM 一次性提交这一帧生成的实例
+	for (int32 MeshIndex = 0; MeshIndex < ISMComponents.Num(); ++MeshIndex)
+	{
+		if (PendingInstances[MeshIndex].IsEmpty())
 		{
-			auto UV = FVector2D(Pos.X / XSize, Pos.Y / YSize);
-			Point.UVPos = UV;
-
-			FTransform Transform;
-			GetTransformFromSeed(Transform, Point, Tile, WorldGenerator);
-
-			auto MeshIndex = FMath::RandRange(0, ISMComponents.Num() - 1); // Randomly select an ISM component
-			auto ISMComponent = ISMComponents[MeshIndex];
-			if (ReplaceInstanceIndices[MeshIndex].Num() > 0)
-			{
-				// Reuse an existing instance index if available
-				auto InstanceIndex = ReplaceInstanceIndices[MeshIndex].Pop(EAllowShrinking::No);
-				ISMComponent->UpdateInstanceTransform(InstanceIndex, Transform, true, true, true);
-				InstanceIndices.Add(FInt32Point(InstanceIndex, MeshIndex));
-			}
-			else
-			{
-				// Add a new instance
-				auto InstanceIndex = ISMComponent->AddInstance(Transform, true);
-				InstanceIndices.Add(FInt32Point(InstanceIndex, MeshIndex));
-			}
+			continue;
+		}
+		CommittedIndices.Reset();
+		PendingInstances[MeshIndex].Commit(ISMComponents[MeshIndex], ReplaceInstanceIndices[MeshIndex], CommittedIndices);
+		for (int32 InstanceIndex : CommittedIndices)
+		{
+			InstanceIndices.Add(FInt32Point(InstanceIndex, MeshIndex));
 		}
 	}
-
-	ensure(TileInstanceIndices.Find(Tile) == nullptr); // Ensure no existing entry for this tile
-	TileInstanceIndices.Add(Tile, MoveTemp(InstanceIndices));
+	return Context.IsFinished();
 }
 
 void AISMClusterSpawner::RemoveTile(FInt32Point Tile)
 {
-	if (TileInstanceIndices.Contains(Tile))
+	if (auto* InstanceIndices = TileInstanceIndices.Find(Tile))
 	{
-		auto& InstanceIndices = TileInstanceIndices[Tile];
-		for (auto Pair : InstanceIndices)
+		// 按 ISM 分组之后立即隐藏，不要等到之后的 tile 复用
+		for (int32 MeshIndex = 0; MeshIndex < ISMComponents.Num(); ++MeshIndex)
 		{
-			UInstancedStaticMeshComponent* ISMComponent = ISMComponents[Pair.Y];
-			ReplaceInstanceIndices[Pair.Y].Add(Pair.X); // Add to replace pool
+			auto& FreeIndices = ReplaceInstanceIndices[MeshIndex];
+			auto OldNumber = FreeIndices.Num();
+			for (auto Pair : *InstanceIndices)
+			{
+				if (Pair.Y == MeshIndex)
+				{
+					FreeIndices.Add(Pair.X); // Add to replace pool
+				}
+			}
+			FISMInstanceBatch::HideInstances(ISMComponents[MeshIndex], TConstArrayView<int32>(FreeIndices).RightChop(OldNumber));
 		}
 		TileInstanceIndices.Remove(Tile);
 	}
@@ -147,30 +173,22 @@ void AISMClusterSpawner::RemoveTile(FInt32Point Tile)
 
 void AISMClusterSpawner::MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX)
 {
-	TMap<FInt32Point, TArray<FInt32Point>> NewTileInstanceIndices;
-	NewTileInstanceIndices.Reserve(TileInstanceIndices.Num());
+	TileInstanceIndices.MoveWorldOrigin(TileXOffset);
 
-	for (auto& It : TileInstanceIndices)
+	for (UInstancedStaticMeshComponent* ISMComponent : ISMComponents)
 	{
-		auto NewKey = FInt32Point(It.Key.X - TileXOffset, It.Key.Y);
-		NewTileInstanceIndices.Add(NewKey, MoveTemp(It.Value));
+		FISMInstanceBatch::OffsetAllInstances(ISMComponent, FVector(-WorldOffsetX, 0.0, 0.0));
 	}
+}
 
-	TileInstanceIndices = MoveTemp(NewTileInstanceIndices);
-
-	// TODO: 是否需要处理 CachedBarriers？
-	for (int32 MeshIndex = 0; MeshIndex < ISMComponents.Num(); ++MeshIndex)
+SIZE_T AISMClusterSpawner::GetTileStorageAllocatedSize() const
+{
+	auto Size = TileInstanceIndices.GetAllocatedSize() + ReplaceInstanceIndices.GetAllocatedSize() + PendingInstances.GetAllocatedSize() + CommittedIndices.GetAllocatedSize();
+	for (int32 MeshIndex = 0; MeshIndex < ReplaceInstanceIndices.Num(); ++MeshIndex)
 	{
-		UInstancedStaticMeshComponent* ISMComponent = ISMComponents[MeshIndex];
-		for (int32 InstanceIndex = 0; InstanceIndex < ISMComponent->GetNumInstances(); ++InstanceIndex)
-		{
-			FTransform OutInstanceTransform;
-			ISMComponent->GetInstanceTransform(InstanceIndex, OutInstanceTransform, false);
-			OutInstanceTransform.SetTranslation(OutInstanceTransform.GetTranslation() - FVector(WorldOffsetX, 0.0, 0.0));
-			ISMComponent->UpdateInstanceTransform(InstanceIndex, OutInstanceTransform, false, false, true);
-		}
-		ISMComponent->MarkRenderStateDirty();
+		Size += ReplaceInstanceIndices[MeshIndex].GetAllocatedSize() + PendingInstances[MeshIndex].GetAllocatedSize();
 	}
+	return Size;
 }
 
 #if WITH_EDITOR
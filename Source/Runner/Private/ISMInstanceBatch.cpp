@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ISMInstanceBatch.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Containers/AllowShrinking.h"
+
+// SortedIndices 升序，Func(int32 RunStart, int32 RunNumber) 中的参数是 SortedIndices 中的位置
+// HISM 关闭了 bAutoRebuildTreeOnInstanceChanges，每批修改之后在后台线程重建一次簇树
+static void RebuildTreeAsync(UInstancedStaticMeshComponent* Component)
+{
+	if (auto* HISMComponent = Cast<UHierarchicalInstancedStaticMeshComponent>(Component))
+	{
+		HISMComponent->BuildTreeIfOutdated(true, false);
+	}
+}
+
+template <class FuncType>
+static void ForEachContiguousRun(TConstArrayView<int32> SortedIndices, FuncType&& Func)
+{
+	int32 RunStart = 0;
+	for (int32 i = 1; i <= SortedIndices.Num(); ++i)
+	{
+		if (i < SortedIndices.Num() && SortedIndices[i] == SortedIndices[i - 1] + 1)
+		{
+			continue;
+		}
+		Func(RunStart, i - RunStart);
+		RunStart = i;
+	}
+}
+
+void FISMInstanceBatch::Commit(UInstancedStaticMeshComponent* Component, TArray<int32>& FreeIndices, TArray<int32>& OutIndices)
+{
+	if (Transforms.IsEmpty())
+	{
+		return;
+	}
+
+	// FreeIndices 按降序排列，末尾的编号最小
+	FreeIndices.Sort(TGreater<int32>());
+	auto ReuseNumber = FMath::Min(FreeIndices.Num(), Transforms.Num());
+	ReusedIndices.Reset();
+	ReusedIndices.Append(FreeIndices.GetData() + FreeIndices.Num() - ReuseNumber, ReuseNumber);
+	FreeIndices.SetNum(FreeIndices.Num() - ReuseNumber, EAllowShrinking::No);
+
+	// 复用的编号排序之后切成连续的区间，每个区间一次 BatchUpdateInstancesTransforms
+	ReusedIndices.Sort();
+	ForEachContiguousRun(ReusedIndices, [this, Component](int32 RunStart, int32 RunNumber) {
+		RunTransforms.Reset();
+		RunTransforms.Append(Transforms.GetData() + RunStart, RunNumber);
+		Component->BatchUpdateInstancesTransforms(ReusedIndices[RunStart], RunTransforms, true, false, true);
+	});
+	OutIndices.Append(ReusedIndices);
+
+	if (ReuseNumber < Transforms.Num())
+	{
+		RunTransforms.Reset();
+		RunTransforms.Append(Transforms.GetData() + ReuseNumber, Transforms.Num() - ReuseNumber);
+		OutIndices.Append(Component->AddInstances(RunTransforms, true, true));
+	}
+
+	// 在最后统一标记 render state 为 dirty
+	Component->MarkRenderStateDirty();
+	RebuildTreeAsync(Component);
+	Transforms.Reset();
+}
+
+void FISMInstanceBatch::OffsetAllInstances(UInstancedStaticMeshComponent* Component, const FVector& Offset)
+{
+	auto InstanceNumber = Component->GetNumInstances();
+	if (InstanceNumber == 0)
+	{
+		return;
+	}
+
+	TArray<FTransform> NewTransforms;
+	NewTransforms.SetNumUninitialized(InstanceNumber);
+	for (int32 InstanceIndex = 0; InstanceIndex < InstanceNumber; ++InstanceIndex)
+	{
+		// 我们假设 ISM 的 transfrom 一直是原点，因此这里 bWorldSpace 为 false，避免矩阵乘法
+		Component->GetInstanceTransform(InstanceIndex, NewTransforms[InstanceIndex], false);
+		NewTransforms[InstanceIndex].AddToTranslation(Offset);
+	}
+	Component->BatchUpdateInstancesTransforms(0, NewTransforms, false, true, true);
+	RebuildTreeAsync(Component);
+}
+
+void FISMInstanceBatch::HideInstances(UInstancedStaticMeshComponent* Component, TConstArrayView<int32> InstanceIndices)
+{
+	if (InstanceIndices.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<int32> SortedIndices(InstanceIndices);
+	SortedIndices.Sort();
+	TArray<FTransform> HiddenTransforms;
+	ForEachContiguousRun(SortedIndices, [Component, &SortedIndices, &HiddenTransforms](int32 RunStart, int32 RunNumber) {
+		HiddenTransforms.SetNum(RunNumber);
+		for (int32 i = 0; i < RunNumber; ++i)
+		{
+			// 保留位置，避免组件的包围盒被拉到原点
+			Component->GetInstanceTransform(SortedIndices[RunStart + i], HiddenTransforms[i], false);
+			HiddenTransforms[i].SetScale3D(FVector::ZeroVector);
+		}
+		Component->BatchUpdateInstancesTransforms(SortedIndices[RunStart], HiddenTransforms, false, false, true);
+	});
+	Component->MarkRenderStateDirty();
+	RebuildTreeAsync(Component);
+}
+
+bool FISMInstanceBatch::Compact(UInstancedStaticMeshComponent* Component, TArray<int32>& FreeIndices, int32 MaxMoves, TMap<int32, int32>& OutRemap)
+{
+	OutRemap.Reset();
+	if (FreeIndices.IsEmpty())
+	{
+		return true;
+	}
+	MaxMoves = FMath::Max(MaxMoves, 1);
+
+	auto InstanceNumber = Component->GetNumInstances();
+	FreeIndices.Sort();
+	FreeMask.Init(false, InstanceNumber);
+	for (auto FreeIndex : FreeIndices)
+	{
+		FreeMask[FreeIndex] = true;
+	}
+
+	// 末尾存活的实例依次填到编号最小的空洞，ReusedIndices 为目标编号（升序），MoveSources 为原编号
+	ReusedIndices.Reset();
+	MoveSources.Reset();
+	auto Tail = InstanceNumber; // [Tail, InstanceNumber) 中都是空闲的实例
+	int32 HoleCursor = 0;
+	while (true)
+	{
+		while (Tail > 0 && FreeMask[Tail - 1])
+		{
+			--Tail;
+		}
+		if (HoleCursor >= FreeIndices.Num() || FreeIndices[HoleCursor] >= Tail || ReusedIndices.Num() >= MaxMoves)
+		{
+			break;
+		}
+		auto To = FreeIndices[HoleCursor++];
+		auto From = Tail - 1;
+		FreeMask[To] = false;
+		FreeMask[From] = true;
+		ReusedIndices.Add(To);
+		MoveSources.Add(From);
+		OutRemap.Add(From, To);
+	}
+
+	// 每个连续区间一次 BatchUpdateInstancesTransforms，自定义数据也按区间一次写入
+	auto CustomDataNumber = Component->NumCustomDataFloats;
+	ForEachContiguousRun(ReusedIndices, [this, Component, CustomDataNumber](int32 RunStart, int32 RunNumber) {
+		RunTransforms.SetNumUninitialized(RunNumber, EAllowShrinking::No);
+		for (int32 i = 0; i < RunNumber; ++i)
+		{
+			Component->GetInstanceTransform(MoveSources[RunStart + i], RunTransforms[i], false);
+		}
+		Component->BatchUpdateInstancesTransforms(ReusedIndices[RunStart], RunTransforms, false, false, true);
+		if (CustomDataNumber > 0)
+		{
+			// 目标区间是连续的，原实例不是，先收集到临时数组，最后的 MarkRenderStateDirty 会重新提交自定义数据
+			RunCustomData.SetNumUninitialized(RunNumber * CustomDataNumber, EAllowShrinking::No);
+			for (int32 i = 0; i < RunNumber; ++i)
+			{
+				FMemory::Memcpy(&RunCustomData[i * CustomDataNumber], &Component->PerInstanceSMCustomData[MoveSources[RunStart + i] * CustomDataNumber], CustomDataNumber * sizeof(float));
+			}
+			FMemory::Memcpy(&Component->PerInstanceSMCustomData[ReusedIndices[RunStart] * CustomDataNumber], RunCustomData.GetData(), RunCustomData.Num() * sizeof(float));
+		}
+	});
+
+	// 末尾的实例全部空闲了，从后往前删除，不会移动其它实例
+	MoveSources.Reset();
+	for (int32 Index = InstanceNumber - 1; Index >= Tail; --Index)
+	{
+		MoveSources.Add(Index);
+	}
+	Component->RemoveInstances(MoveSources);
+	// 用掉的空洞在 FreeIndices 的开头，被删除的在末尾
+	FreeIndices.RemoveAll([Tail](int32 FreeIndex) { return FreeIndex >= Tail; });
+	FreeIndices.RemoveAt(0, HoleCursor, EAllowShrinking::No);
+	Component->MarkRenderStateDirty();
+	RebuildTreeAsync(Component);
+	return FreeIndices.IsEmpty();
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ISMRenderSettings.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "GameFramework/Actor.h"
+
+UInstancedStaticMeshComponent* FISMRenderSettings::CreateComponent(AActor* Owner, const UInstancedStaticMeshComponent* Template, EComponentMobility::Type Mobility) const
+{
+	auto* ComponentClass = bUseHierarchicalInstances ? UHierarchicalInstancedStaticMeshComponent::StaticClass() : UInstancedStaticMeshComponent::StaticClass();
+	auto* Component = NewObject<UInstancedStaticMeshComponent>(Owner, ComponentClass, NAME_None, RF_Transient);
+	Component->SetMobility(Mobility);
+	Component->SetStaticMesh(Template->GetStaticMesh());
+	for (int32 MaterialIndex = 0; MaterialIndex < Template->GetNumOverrideMaterials(); ++MaterialIndex)
+	{
+		Component->SetMaterial(MaterialIndex, Template->OverrideMaterials[MaterialIndex]);
+	}
+	// 复制完整的碰撞设置（对象类型、各通道的响应等），不只是 profile 名字
+	Component->BodyInstance.CopyBodyInstancePropertiesFrom(&Template->BodyInstance);
+	Component->SetCastShadow(Template->CastShadow);
+	Component->bReceivesDecals = Template->bReceivesDecals;
+	if (HasCullDistances())
+	{
+		Component->SetCullDistances(StartCullDistance, EndCullDistance);
+	}
+	else
+	{
+		Component->SetCullDistances(Template->InstanceStartCullDistance, Template->InstanceEndCullDistance);
+	}
+	if (auto* HISMComponent = Cast<UHierarchicalInstancedStaticMeshComponent>(Component))
+	{
+		// 每批实例提交之后由 FISMInstanceBatch 异步重建
+		HISMComponent->bAutoRebuildTreeOnInstanceChanges = false;
+	}
+	Component->SetupAttachment(Owner->GetRootComponent());
+	Component->RegisterComponent();
+	return Component;
+}
+
+UInstancedStaticMeshComponent* FISMRenderSettings::ApplyTo(AActor* Owner, UInstancedStaticMeshComponent* Component) const
+{
+	if (!Component)
+	{
+		return nullptr;
+	}
+	if (Component->IsA<UHierarchicalInstancedStaticMeshComponent>() == bUseHierarchicalInstances)
+	{
+		// 没有配置时保留编辑器中设置在组件上的剔除距离
+		if (HasCullDistances())
+		{
+			Component->SetCullDistances(StartCullDistance, EndCullDistance);
+		}
+		return Component;
+	}
+
+	// 运行时实例还没有生成，直接换成新建的组件
+	auto* NewComponent = CreateComponent(Owner, Component, Component->Mobility);
+	if (Component == Owner->GetRootComponent())
+	{
+		// 根组件不能销毁，只保留为空的挂点
+		Component->SetVisibility(false);
+		Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+	else
+	{
+		Component->DestroyComponent();
+	}
+	return NewComponent;
+}
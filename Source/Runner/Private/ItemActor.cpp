@@ -1,22 +1,50 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "ItemActor.h"
+#include "Components/StaticMeshComponent.h"
 
 void AItemActor::BeginPlay()
 {
 	Super::BeginPlay();
 	InitialZ = GetActorLocation().Z;
 	CurrentTime = 0.0f;
+	// WPO 的位移不在包围盒中，按振幅放大包围盒，否则晃到上方时会被错误地剔除
+	auto Radius = StaticMesh->Bounds.SphereRadius;
+	if (bMaterialDrivesMotion && Radius > 0.0)
+	{
+		StaticMesh->SetBoundsScale(StaticMesh->BoundsScale * (Radius + FMath::Abs(Amplitude)) / Radius);
+	}
+	StaticMesh->SetCustomPrimitiveDataFloat(BobFrequencyDataIndex, Frequency);
+	SetBobAmplitude(Amplitude);
+}
+
+void AItemActor::OnAcquiredFromPool_Implementation()
+{
+	Super::OnAcquiredFromPool_Implementation();
+	// 晃动以新的位置为中心
+	InitialZ = GetActorLocation().Z;
+	CurrentTime = 0.0f;
+	SetBobAmplitude(Amplitude);
 }
 
-void AItemActor::Tick(float DeltaTime)
+void AItemActor::TickMotion(float DeltaTime)
 {
-	Super::Tick(DeltaTime);
 	// 道具上下晃动会影响收集
 	if (!bAttracted)
 	{
 		CurrentTime += DeltaTime;
-		float NewZ = InitialZ + FMath::Sin(CurrentTime * Frequency) * Amplitude;
+		auto NewZ = InitialZ + FMath::Sin(CurrentTime * Frequency) * Amplitude;
 		SetActorLocation(FVector(GetActorLocation().X, GetActorLocation().Y, NewZ));
 	}
-}
\ No newline at end of file
+}
+
+void AItemActor::StartAttract()
+{
+	Super::StartAttract();
+	SetBobAmplitude(0.0f);
+}
+
+void AItemActor::SetBobAmplitude(float InAmplitude)
+{
+	StaticMesh->SetCustomPrimitiveDataFloat(BobAmplitudeDataIndex, InAmplitude);
+}
@@ -1,47 +1,59 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "LaserSpawner.h"
+#include "ActorPoolSubsystem.h"
 #include "Engine/World.h"
 #include "Math/MathFwd.h"
 
-void ALaserSpawner::BeginPlay()
+int32 ALaserSpawner::GetDefaultPoolSize() const
 {
-	Super::BeginPlay();
-	MaxCachedBarriers = 0; // 有两类激光，就不缓存了
+	// 每个点生成一行激光
+	return Super::GetDefaultPoolSize() * OneLineLaserNumber;
 }
 
-void ALaserSpawner::SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator)
+void ALaserSpawner::PrewarmPool(UActorPoolSubsystem& Pool, int32 Count) const
 {
+	Super::PrewarmPool(Pool, Count);
+	Pool.Prewarm(AnotherLaserClass, SpecialLaserPoolSize);
+}
+
+bool ALaserSpawner::SpawnBarriers(FBarrierSpawnContext& Context)
+{
+	auto* WorldGenerator = Context.WorldGenerator;
+	auto Tile = Context.Tile;
 	if (!WorldGenerator || !BarrierClass)
 	{
-		return;
+		return true;
 	}
 
 	auto YSize = WorldGenerator->YCellNumber * WorldGenerator->CellSize;
 	// auto YDist = YSize / OneLineLaserNumber;
-	auto bGenerateSpecialLaser = false;
+	// 跨帧时需要记住这个 tile 是否已经生成过特殊激光
+	auto bGenerateSpecialLaser = Context.SpawnerState != 0;
 
-	for (auto& Point : Positions)
+	for (; !Context.IsFinished() && !Context.ShouldYield(); ++Context.Cursor)
 	{
+		auto Point = Context.Positions[Context.Cursor];
 		// if (!CanSpawnThisBarrier(Tile, Point.UVPos, WorldGenerator))
 		// {
 		// 	continue; // 跳过不允许生成障碍物的区域
 		// }
 
 		FTransform Transform;
-		GetTransformFromSeed(Transform, Point, Tile, WorldGenerator);
+		GetTransformFromSeed(Transform, Context);
 
 		if (WorldGenerator->CurrentDifficulty >= 5 && !bGenerateSpecialLaser && Point.Rotation.Pitch > ProbabilityForBaseLaser && CanSpawnThisBarrier(Tile, Point.UVPos, WorldGenerator))
 		{
-			WorldGenerator->SpecialLaserPos.Add(FMath::Fmod(Tile.X + Point.UVPos.X, double(WorldGenerator->MoveOriginXTile)));
+			WorldGenerator->AddSpecialLaser(Tile, Point.UVPos.X);
 			
 			FVector Location = Transform.GetLocation();
 			Location.Y = YSize / 2.0;
 			Transform.SetLocation(Location);
 			Transform.SetRotation(FQuat::Identity);
-			auto CachedActor = GetWorld()->SpawnActor<AActor>(AnotherLaserClass, Transform);
-			SpawnedBarriers.Add(Tile, CachedActor);
+			AcquireBarrier(AnotherLaserClass, Transform, Tile);
 			bGenerateSpecialLaser = true;
+			Context.SpawnerState = 1;
+			Context.Budget->Consume();
 		}
 		else
 		{
@@ -57,11 +69,10 @@ void ALaserSpawner::SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point
 				ensure(Location.Y >= 0 && Location.Y <= YSize); // 确保位置在有效范围内
 				Transform.SetLocation(Location);
 				Transform.SetRotation(FQuat::Identity);
-
-				AActor* CachedActor = nullptr;
-				CachedActor = GetWorld()->SpawnActor<AActor>(BarrierClass, Transform);
-				SpawnedBarriers.Add(Tile, CachedActor);
+				AcquireBarrier(BarrierClass, Transform, Tile);
 			}
+			Context.Budget->Consume(OneLineLaserNumber);
 		}
 	}
+	return Context.IsFinished();
 }
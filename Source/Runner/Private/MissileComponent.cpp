@@ -30,13 +30,13 @@ void UMissileComponent::BeginPlay()
 	SetComponentTickInterval(TickInterval);
 }
 
-FVector UMissileComponent::PredictPlayerPos(FVector PlayerPos)
+FVector UMissileComponent::PredictPlayerPos(FVector PlayerPos, FTileRandomStream& Random)
 {
 	auto Speed = TotalDistance / TotalTime;
 	auto CenterPos = FVector2D(PlayerPos.X + Speed * MissileReachTime, PlayerPos.Y);
 
-	auto Angle = FMath::RandRange(-90.0, 90.0); // 随机角度
-	auto Rand = FMath::RandRange(0.0, 1.0);
+	auto Angle = Random.NextRange(-90.0, 90.0); // 随机角度
+	auto Rand = Random.NextUnit();
 	auto PowRand = FMath::Pow(Rand, double(Tension)); // 根据 Tension 调整随机性
 
 	auto Radius = RandomRadius * PowRand;
@@ -55,10 +55,10 @@ FVector UMissileComponent::PredictPlayerPos(FVector PlayerPos)
 	return FVector(PredictPos.X, PredictPos.Y, Height);
 }
 
-FVector UMissileComponent::RandomMissileStartPos(FVector TargetPos)
+FVector UMissileComponent::RandomMissileStartPos(FVector TargetPos, FTileRandomStream& Random)
 {
-	auto RandAngle = FMath::RandRange(0.0, 180.0);
-	auto RandRadius = FMath::RandRange(MissileMinStartOffset, MissileMaxStartOffset);
+	auto RandAngle = Random.NextRange(0.0, 180.0);
+	auto RandRadius = Random.NextRange(MissileMinStartOffset, MissileMaxStartOffset);
 	auto OffsetX = RandRadius * FMath::Cos(FMath::DegreesToRadians(RandAngle));
 	auto OffsetY = RandRadius * FMath::Sin(FMath::DegreesToRadians(RandAngle));
 	return FVector(TargetPos.X + OffsetX, TargetPos.Y + OffsetY, TargetPos.Z + 4000.0);
@@ -93,12 +93,13 @@ void UMissileComponent::TickComponent(float DeltaTime, ELevelTick TickType, FAct
 	double lambda = 1.0 / ExpectedDistance[DistanceDifficulty];
 	auto Probability = FMath::Exp(-lambda * TotalDistance);
 
-	auto Rand = FMath::FRandRange(0.0, 1.0);
+	auto Random = WorldGenerator->MakeTileRandom(FInt32Point::ZeroValue, ETileRandomStream::Missile, RandomCounter++);
+	auto Rand = Random.NextUnit();
 	if (Rand > Probability || bDebug)
 	{
 		// Trigger missile launch
-		auto PredictPos = PredictPlayerPos(Character->GetActorLocation());
-		auto StartPos = RandomMissileStartPos(PredictPos);	
+		auto PredictPos = PredictPlayerPos(Character->GetActorLocation(), Random);
+		auto StartPos = RandomMissileStartPos(PredictPos, Random);	
 
 		auto ZAxis = (PredictPos - StartPos).GetSafeNormal();
 		auto Rotation = FRotationMatrix::MakeFromZ(ZAxis).Rotator();
@@ -1,7 +1,84 @@
 #include "PCGWorker.h"
+#include "HAL/Event.h"
 #include "HAL/Platform.h"
+#include "HAL/PlatformAffinity.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+
+FPCGWorker::FPCGWorker(FExecutor InExecutor, uint32 InQueueCapacity)
+  : Executor(MoveTemp(InExecutor)), Requests(InQueueCapacity + 1)
+{
+  WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+FPCGWorker::~FPCGWorker()
+{
+  if (Thread)
+  {
+    // Kill 会调用 Stop 并等待当前请求执行完毕
+    Thread->Kill(true);
+    delete Thread;
+    Thread = nullptr;
+  }
+  FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+  WorkEvent = nullptr;
+}
+
+bool FPCGWorker::Start(const TCHAR* ThreadName, EThreadPriority Priority, uint64 AffinityMask)
+{
+  check(Thread == nullptr);
+  if (AffinityMask == 0)
+  {
+    AffinityMask = FPlatformAffinity::GetNoAffinityMask();
+  }
+  Thread = FRunnableThread::Create(this, ThreadName, 0, Priority, AffinityMask);
+  return Thread != nullptr;
+}
+
+bool FPCGWorker::Submit(const FPCGRequest& Request)
+{
+  if (!Requests.Enqueue(Request))
+  {
+    return false; // 队列已满
+  }
+  WorkEvent->Trigger();
+  return true;
+}
+
+void FPCGWorker::Shutdown(TFunctionRef<void(const FPCGRequest&)> OnDropped)
+{
+  if (Thread)
+  {
+    Thread->Kill(true);
+    delete Thread;
+    Thread = nullptr;
+  }
+  // 线程已经退出，game 线程成为唯一的消费者
+  FPCGRequest Request;
+  while (Requests.Dequeue(Request))
+  {
+    OnDropped(Request);
+  }
+}
 
 uint32 FPCGWorker::Run()
 {
+  while (!bStopRequested)
+  {
+    FPCGRequest Request;
+    if (Requests.Dequeue(Request))
+    {
+      Executor(Request);
+      continue;
+    }
+    // 没有请求时休眠，Submit 和 Stop 都会唤醒线程
+    WorkEvent->Wait();
+  }
   return 0;
-}
\ No newline at end of file
+}
+
+void FPCGWorker::Stop()
+{
+  bStopRequested = true;
+  WorkEvent->Trigger();
+}
@@ -3,18 +3,22 @@
 
 #include "RunnerCoinActor.h"
 #include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
 
 ARunnerCoinActor::ARunnerCoinActor()
 {
   Collision->ComponentTags.Add("GoldCoin");
 }
 
+void ARunnerCoinActor::BeginPlay()
+{
+  Super::BeginPlay();
+  StaticMesh->SetCustomPrimitiveDataFloat(SpinSpeedDataIndex, SpinSpeed);
+}
 
-void ARunnerCoinActor::Tick(float DeltaTime)
+void ARunnerCoinActor::TickMotion(float DeltaTime)
 {
-  Super::Tick(DeltaTime);
-  auto Rot = FRotator(0, 300 * DeltaTime, 0);
-  AddActorLocalRotation(Rot);
+  AddActorLocalRotation(FRotator(0.0, SpinSpeed * DeltaTime, 0.0));
 }
 
 
@@ -27,13 +27,31 @@ FRotator ARunnerControllerBase::GetControlRotation() const
 
 void ARunnerControllerBase::WhenCountDownOver()
 {
+  TActorIterator<AWorldGenerator> It(GetWorld());
+  auto* WorldGenerator = It ? *It : nullptr;
+  if (WorldGenerator)
+  {
+    if (!WorldGenerator->IsWorldReady())
+    {
+      // 起始区域还没有生成完，生成完成后再开始
+      if (!WorldReadyHandle.IsValid())
+      {
+        WorldReadyHandle = WorldGenerator->OnWorldReady.AddUObject(this, &ARunnerControllerBase::WhenCountDownOver);
+      }
+      return;
+    }
+    if (WorldReadyHandle.IsValid())
+    {
+      WorldGenerator->OnWorldReady.Remove(WorldReadyHandle);
+      WorldReadyHandle.Reset();
+    }
+  }
+
   auto* Runner = Cast<ARunnerCharacter>(GetPawn());
   Runner->GameStart();
 
-  TActorIterator<AWorldGenerator> It(GetWorld());
-  if (It)
+  if (WorldGenerator)
   {
-    auto* WorldGenerator = *It;
     WorldGenerator->SetGameStart();
   }
 }
\ No newline at end of file
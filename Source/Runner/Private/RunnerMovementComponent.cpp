@@ -641,6 +641,10 @@ bool URunnerMovementComponent::CheckFall(const FFindFloorResult& OldFloor, const
 		{
 			// If still walking, then fall. If not, assume the user set a different mode they want to keep.
 			OldHit = OldFloor.HitResult;
+			if (auto* OldHitSpawner = Cast<ABarrierSpawner>(OldHit.GetActor()))
+			{
+				OldHitRemapSerial = OldHitSpawner->GetInstanceRemapSerial();
+			}
 			StartFalling(Iterations, remainingTime, timeTick, Delta, OldLocation);
 		}
 		return true;
@@ -762,9 +766,10 @@ double URunnerMovementComponent::CalcStartZVelocity() const
 	if (OldHit.IsValidBlockingHit())
 	{
 		auto OldHitActor = Cast<ABarrierSpawner>(OldHit.GetActor());
-		if (OldHitActor && OldHitActor->BarrierHasCustomSlope())
+		// ISM 在这之后被压缩过的话 Item 可能已经指向其它实例，退回使用上一帧的 Roll
+		if (OldHitActor && OldHitActor->BarrierHasCustomSlope() && OldHitActor->GetInstanceRemapSerial() == OldHitRemapSerial)
 		{
-			LastRoll = OldHitActor->GetCustomSlopeAngle(OldHit.Item);
+			LastRoll = OldHitActor->GetCustomSlopeAngle(OldHit.GetComponent(), OldHit.Item);
 		}
 		OldHit.Reset();
 	}
@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SpawnTransform.h"
+#include "BarrierSpawner.h"
+#include "Math/RotationMatrix.h"
+#include "TileRandom.h"
+#include "WorldGenerator.h"
+
+namespace SpawnTransform
+{
+	// 对齐到地面，规则和 AWorldGenerator 中基于地形网格的查询一致
+	static void Align(const FSpawnTransformParams& Params, const FTerrainHeightSampler& Sampler, FVector& Location, FRotator& Rotation)
+	{
+		// 对齐到地面法线
+		if (Params.AlignMode == EAlignMode::AlignNormal)
+		{
+			auto Normal = Sampler.GetNormal(FVector2D(Location));
+
+			auto ForwardDir = FRotator(0.0, Rotation.Yaw, 0.0).Vector();
+			// 取 80 是为了避免超出边界
+			auto ForwardPos = Location + ForwardDir * FMath::Min(Params.BarrierRadius / 2, 80.0);
+
+			ForwardPos.Z = Sampler.GetHeight(FVector2D(ForwardPos));
+			auto Pitch = (ForwardPos - Location).GetSafeNormal();
+
+			auto AlignedRotation = FRotationMatrix::MakeFromXZ(Pitch, Normal).Rotator();
+
+			Rotation.Pitch += AlignedRotation.Pitch;
+			Rotation.Roll += AlignedRotation.Roll;
+
+			Location += Normal * Params.BarrierOffset;
+		}
+		// 对齐到重力方向
+		else if (Params.AlignMode == EAlignMode::AlignGravity)
+		{
+			auto Normal = Sampler.GetNormal(FVector2D(Location));
+
+			double Zoffset = 0.0;
+			if (Normal.Z > UE_SMALL_NUMBER)
+			{
+				Zoffset = -FMath::Sqrt((1 - Normal.Z * Normal.Z)) * Params.BarrierRadius / Normal.Z;
+			}
+			Zoffset += Params.BarrierOffset;
+
+			Location += FVector(0, 0, Zoffset);
+		}
+		else
+		{
+			Location += FVector(0, 0, Params.BarrierOffset);
+		}
+	}
+
+	FTransform FromSeed(const FWorldGenConfig& Config, const FSpawnTransformParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, const RandomPoint& Seed)
+	{
+		auto Rotation = FRotator(
+				Params.BaseRotation.Pitch + Params.SeedRotationScale.Pitch * Seed.Rotation.Pitch,
+				Params.BaseRotation.Yaw + Params.SeedRotationScale.Yaw * Seed.Rotation.Yaw,
+				Params.BaseRotation.Roll + Params.SeedRotationScale.Roll * Seed.Rotation.Roll);
+		return FromSeed(Config, Params, Sampler, Tile, Seed, Rotation);
+	}
+
+	FTransform FromSeed(const FWorldGenConfig& Config, const FSpawnTransformParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, const RandomPoint& Seed, FRotator Rotation)
+	{
+		// 重映射 UV，避免生成在边缘位置
+		auto U = FMath::Lerp(0.01, 0.99, Seed.UVPos.X);
+		auto V = FMath::Lerp(0.01, 0.99, Seed.UVPos.Y);
+		auto Pos = FVector2D((Tile.X + U) * Config.GetTileSizeX(), (Tile.Y + V) * Config.GetTileSizeY());
+		auto Location = FVector(Pos, Sampler.GetHeight(Pos));
+
+		Align(Params, Sampler, Location, Rotation);
+		Rotation.Pitch = FMath::Min(Rotation.Pitch, Params.MaxPitch);
+		return FTransform(Rotation.Quaternion(), Location);
+	}
+
+	void FromSeeds(const FWorldGenConfig& Config, const FSpawnTransformParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, FSpawnSeedView Seeds, TArray<FTransform>& OutTransforms)
+	{
+		OutTransforms.SetNumUninitialized(Seeds.Num());
+		for (int32 Index = 0; Index < Seeds.Num(); ++Index)
+		{
+			OutTransforms[Index] = FromSeed(Config, Params, Sampler, Tile, Seeds[Index]);
+		}
+	}
+
+	void PlanCluster(const FWorldGenConfig& Config, const FSpawnTransformParams& Params, const FClusterLayoutParams& Layout, const FTerrainHeightSampler& Sampler, FInt32Point Tile, const RandomPoint& Seed, FTileRandomStream& Random, TArray<FPlannedInstance>& OutInstances)
+	{
+		auto XSize = Config.GetTileSizeX();
+		auto YSize = Config.GetTileSizeY();
+		auto IsValidPos = [XSize, YSize, MinDist = Layout.MinDistance](FVector2D Pos, TConstArrayView<FVector2D> PlacedPos) {
+			if (Pos.X < 0 || Pos.X >= XSize || Pos.Y < 0 || Pos.Y >= YSize)
+			{
+				return false;
+			}
+			for (const auto& Other : PlacedPos)
+			{
+				if (FVector2D::DistSquared(Pos, Other) < FMath::Square(MinDist))
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		auto MeshCountInCluster = Random.NextIntRange(Layout.MinMeshCount, Layout.MaxMeshCount);
+		auto TilePos = FVector2D(Seed.UVPos.X * XSize, Seed.UVPos.Y * YSize);
+
+		TArray<FVector2D, TInlineAllocator<8>> PlacedPos;
+		PlacedPos.Add(TilePos);
+		for (int32 i = 1; i < MeshCountInCluster; ++i)
+		{
+			int32 TryNumber = 0;
+			while (TryNumber < Layout.TryTimes)
+			{
+				auto X = Random.NextRange(-1.0, 1.0);
+				auto Y = Random.NextRange(-1.0, 1.0);
+				auto NewPos = TilePos + FVector2D(X, Y) * Layout.HalfExtent;
+				if (!IsValidPos(NewPos, PlacedPos))
+				{
+					// 超出边界，重新尝试
+					++TryNumber;
+					continue;
+				}
+				PlacedPos.Add(NewPos);
+				break;
+			}
+			if (TryNumber >= Layout.TryTimes)
+			{
+				UE_LOG(LogBarrierSpawner, Warning, TEXT("ISMClusterSpawner: Failed to place enough meshes in cluster at tile %s"), *Tile.ToString());
+				break;
+			}
+		}
+
+		auto Point = Seed;
+		for (auto Pos : PlacedPos)
+		{
+			Point.UVPos = FVector2D(Pos.X / XSize, Pos.Y / YSize);
+			auto& Instance = OutInstances.AddDefaulted_GetRef();
+			Instance.Transform = FromSeed(Config, Params, Sampler, Tile, Point);
+			Instance.MeshIndex = Random.NextIntRange(0, Layout.MeshNumber - 1); // Randomly select an ISM component
+		}
+	}
+} // namespace SpawnTransform
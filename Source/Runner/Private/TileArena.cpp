@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TileArena.h"
+
+static constexpr SIZE_T TileArenaBlockAlignment = 64;
+
+FTileArena::~FTileArena()
+{
+	while (OverflowChunks)
+	{
+		auto* Next = OverflowChunks->Next;
+		FMemory::Free(OverflowChunks);
+		OverflowChunks = Next;
+	}
+	FMemory::Free(Block);
+	Block = nullptr;
+	Capacity = 0;
+}
+
+void* FTileArena::Allocate(SIZE_T Size, SIZE_T Alignment)
+{
+	auto AlignedOffset = Align(Offset, Alignment);
+	if (AlignedOffset + Size <= Capacity)
+	{
+		Offset = AlignedOffset + Size;
+		return Block + AlignedOffset;
+	}
+
+	// 主内存块不够用，这一轮先单独分配，Reset 时按总用量扩大主内存块
+	auto ChunkSize = sizeof(FOverflowChunk) + Alignment + Size;
+	auto* Chunk = static_cast<FOverflowChunk*>(FMemory::Malloc(ChunkSize, alignof(FOverflowChunk)));
+	Chunk->Next = OverflowChunks;
+	OverflowChunks = Chunk;
+	OverflowBytes += Alignment + Size;
+	++HeapAllocationCount;
+	return Align(reinterpret_cast<uint8*>(Chunk + 1), Alignment);
+}
+
+void FTileArena::Reset()
+{
+	if (OverflowChunks)
+	{
+		while (OverflowChunks)
+		{
+			auto* Next = OverflowChunks->Next;
+			FMemory::Free(OverflowChunks);
+			OverflowChunks = Next;
+		}
+		// 留出一些余量，tile 之间的用量略有差别时不需要再次扩大
+		auto NewCapacity = Align((Offset + OverflowBytes) * 5 / 4, 4096);
+		FMemory::Free(Block);
+		Block = static_cast<uint8*>(FMemory::Malloc(NewCapacity, TileArenaBlockAlignment));
+		Capacity = NewCapacity;
+		OverflowBytes = 0;
+		++HeapAllocationCount;
+	}
+	Offset = 0;
+}
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TileExclusion.h"
+
+uint32 FTileExclusionIndex::CellMask(double Min, double Max)
+{
+	if (Max < 0.0 || Min > 1.0 || Min > Max)
+	{
+		return 0;
+	}
+	auto First = ToCell(Min);
+	auto Last = ToCell(Max);
+	// 第 First 到 Last 位
+	auto Upper = Last == 31 ? MAX_uint32 : (1u << (Last + 1)) - 1;
+	return Upper & ~((1u << First) - 1);
+}
+
+void FTileExclusionIndex::AddBox(FInt32Point Tile, FVector2D Center, double HalfExtent)
+{
+	auto Box = FBox2D(Center - FVector2D(HalfExtent), Center + FVector2D(HalfExtent));
+	auto RowMask = CellMask(Box.Min.X, Box.Max.X);
+	if (RowMask == 0 || Box.Max.Y < 0.0 || Box.Min.Y > 1.0)
+	{
+		return; // 和 tile 不相交
+	}
+
+	auto& Entry = TileBoxes.FindOrAdd(Tile);
+	for (int32 V = ToCell(Box.Min.Y); V <= ToCell(Box.Max.Y); ++V)
+	{
+		Entry.Rows[V] |= RowMask;
+	}
+	Entry.Boxes.Add(Box);
+}
+
+void FTileExclusionIndex::AddBandX(FInt32Point Tile, double CenterU, double HalfWidth)
+{
+	auto MinU = CenterU - HalfWidth;
+	auto MaxU = CenterU + HalfWidth;
+	auto OwnerX = ColumnBands.ToAbsolute(Tile).X;
+	AddBandToColumn(Tile.X, OwnerX, MinU, MaxU);
+	if (MinU < 0.0)
+	{
+		AddBandToColumn(Tile.X - 1, OwnerX, MinU + 1.0, MaxU + 1.0);
+	}
+	if (MaxU > 1.0)
+	{
+		AddBandToColumn(Tile.X + 1, OwnerX, MinU - 1.0, MaxU - 1.0);
+	}
+}
+
+void FTileExclusionIndex::AddBandToColumn(int32 ColumnX, int32 OwnerX, double MinU, double MaxU)
+{
+	auto& Column = ColumnBands.FindOrAdd(FInt32Point(ColumnX, 0));
+	Column.Mask |= CellMask(MinU, MaxU);
+	Column.Bands.Add(FBand{ OwnerX, MinU, MaxU });
+}
+
+bool FTileExclusionIndex::IsExcluded(FInt32Point Tile, FVector2D UV) const
+{
+	auto Bit = 1u << ToCell(UV.X);
+
+	if (auto* Column = ColumnBands.Find(FInt32Point(Tile.X, 0)); Column && (Column->Mask & Bit))
+	{
+		for (const auto& Band : Column->Bands)
+		{
+			if (UV.X > Band.MinU && UV.X < Band.MaxU)
+			{
+				return true;
+			}
+		}
+	}
+
+	if (auto* Entry = TileBoxes.Find(Tile); Entry && (Entry->Rows[ToCell(UV.Y)] & Bit))
+	{
+		for (const auto& Box : Entry->Boxes)
+		{
+			if (Box.IsInsideOrOn(UV))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void FTileExclusionIndex::RemoveTile(FInt32Point Tile)
+{
+	TileBoxes.Remove(Tile);
+
+	auto OwnerX = ColumnBands.ToAbsolute(Tile).X;
+	for (int32 ColumnX = Tile.X - 1; ColumnX <= Tile.X + 1; ++ColumnX)
+	{
+		auto* Column = ColumnBands.Find(FInt32Point(ColumnX, 0));
+		if (!Column || Column->Bands.RemoveAll([OwnerX](const FBand& Band) { return Band.OwnerX == OwnerX; }) == 0)
+		{
+			continue;
+		}
+		if (Column->Bands.IsEmpty())
+		{
+			ColumnBands.Remove(FInt32Point(ColumnX, 0));
+			continue;
+		}
+		// 重新计算这一列的位图
+		Column->Mask = 0;
+		for (const auto& Band : Column->Bands)
+		{
+			Column->Mask |= CellMask(Band.MinU, Band.MaxU);
+		}
+	}
+}
+
+void FTileExclusionIndex::MoveWorldOrigin(int32 TileXOffset)
+{
+	TileBoxes.MoveWorldOrigin(TileXOffset);
+	ColumnBands.MoveWorldOrigin(TileXOffset);
+}
+
+void FTileExclusionIndex::Reset()
+{
+	TileBoxes.Reset();
+	ColumnBands.Reset();
+}
@@ -4,12 +4,12 @@
 #include "Components/StaticMeshComponent.h"
 #include "Math/MathFwd.h"
 #include "UObject/UObjectGlobals.h"
+#include "WheelLaserSubsystem.h"
 
 // Sets default values
 AWheelLaser::AWheelLaser()
 {
-	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bCanEverTick = false;
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("RootComponent"));
 	CenterSphere = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("CenterSphere"));
 	CenterSphere->SetupAttachment(RootComponent);
@@ -19,16 +19,35 @@ AWheelLaser::AWheelLaser()
 void AWheelLaser::BeginPlay()
 {
 	Super::BeginPlay();
+	if (auto* Subsystem = GetWorld()->GetSubsystem<UWheelLaserSubsystem>())
+	{
+		Subsystem->Register(this);
+	}
 }
 
-// Called every frame
-void AWheelLaser::Tick(float DeltaTime)
+void AWheelLaser::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (auto* Subsystem = GetWorld()->GetSubsystem<UWheelLaserSubsystem>())
+	{
+		Subsystem->Unregister(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
 
-	auto Angle = RotationSpeed * DeltaTime;
-	FRotator NewRotation = FRotator(0.0, 0.0, Angle);
-	RootComponent->AddRelativeRotation(NewRotation);
+void AWheelLaser::OnAcquiredFromPool_Implementation()
+{
+	if (auto* Subsystem = GetWorld()->GetSubsystem<UWheelLaserSubsystem>())
+	{
+		Subsystem->Register(this);
+	}
+}
+
+void AWheelLaser::OnReturnedToPool_Implementation()
+{
+	if (auto* Subsystem = GetWorld()->GetSubsystem<UWheelLaserSubsystem>())
+	{
+		Subsystem->Unregister(this);
+	}
 }
 
 void AWheelLaser::OnConstruction(const FTransform& Transform)
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WheelLaserSubsystem.h"
+#include "Components/SceneComponent.h"
+#include "WheelLaser.h"
+
+void UWheelLaserSubsystem::Register(AWheelLaser* Laser)
+{
+	Lasers.AddUnique(Laser);
+}
+
+void UWheelLaserSubsystem::Unregister(AWheelLaser* Laser)
+{
+	Lasers.RemoveSwap(Laser);
+}
+
+bool UWheelLaserSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWheelLaserSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWheelLaserSubsystem, STATGROUP_Tickables);
+}
+
+void UWheelLaserSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	Lasers.RemoveAllSwap([DeltaTime](const TWeakObjectPtr<AWheelLaser>& WeakLaser) {
+		auto* Laser = WeakLaser.Get();
+		if (!Laser)
+		{
+			return true;
+		}
+		auto Angle = Laser->RotationSpeed * DeltaTime;
+		Laser->GetRootComponent()->AddRelativeRotation(FRotator(0.0, 0.0, Angle));
+		return false;
+	});
+}
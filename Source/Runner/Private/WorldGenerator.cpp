@@ -2,23 +2,22 @@
 
 #include "WorldGenerator.h"
 #include "Algo/MinElement.h"
-#include "Async/Async.h"
-#include "Async/TaskGraphInterfaces.h"
 #include "BarrierSpawner.h"
 #include "Containers/AllowShrinking.h"
 #include "Containers/Array.h"
 #include "Containers/ArrayView.h"
+#include "CoinTrajectory.h"
 #include "DrawDebugHelpers.h"
 #include "Engine/World.h"
 #include "EngineUtils.h"
 #include "GameFramework/Actor.h"
 #include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/PlayerStart.h"
 #include "GoldCoinSpawner.h"
 #include "HAL/Platform.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetMaterialLibrary.h"
-#include "KismetProceduralMeshLibrary.h"
 #include "KismetTraceUtils.h"
 #include "Materials/MaterialInstanceConstant.h"
 #include "Materials/MaterialInstanceDynamic.h"
@@ -30,45 +29,69 @@
 #include "MissileComponent.h"
 #include "ProceduralMeshComponent.h"
 #include "Runner/RunnerGameMode.h"
+#include "SpawnTransform.h"
+#include "Stats/Stats.h"
+#include "Tasks/Task.h"
+#include "TileRandom.h"
 #include "Templates/Tuple.h"
 #include "Templates/UnrealTemplate.h"
 #include "UObject/ObjectPtr.h"
 #include <algorithm>
 #include <cstdint>
 #include <functional>
-#include <random>
 
 DEFINE_LOG_CATEGORY_STATIC(LogWorldGenerator, Log, All);
 
-// 从 Async.cpp 中 copy 过来的
-class FPCGAsyncGraphTask : public FAsyncGraphTaskBase
+DECLARE_STATS_GROUP(TEXT("WorldGenerator"), STATGROUP_WorldGenerator, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Tile Heights"), STAT_WorldGen_Heights, STATGROUP_WorldGenerator);
+DECLARE_CYCLE_STAT(TEXT("Tile Normals"), STAT_WorldGen_Normals, STATGROUP_WorldGenerator);
+DECLARE_CYCLE_STAT(TEXT("Tile Points"), STAT_WorldGen_Points, STATGROUP_WorldGenerator);
+DECLARE_CYCLE_STAT(TEXT("Tile Spawn Plans"), STAT_WorldGen_SpawnPlans, STATGROUP_WorldGenerator);
+DECLARE_CYCLE_STAT(TEXT("Tile Ground Mesh"), STAT_WorldGen_GroundMesh, STATGROUP_WorldGenerator);
+DECLARE_CYCLE_STAT(TEXT("Tile Barriers"), STAT_WorldGen_Barriers, STATGROUP_WorldGenerator);
+DECLARE_CYCLE_STAT(TEXT("Warm Start"), STAT_WorldGen_WarmStart, STATGROUP_WorldGenerator);
+// FTileArena 的溢出加上按 tile 存放的容器的扩容次数，稳态下应当为 0
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Heap Allocations"), STAT_WorldGen_TileHeapAllocations, STATGROUP_WorldGenerator);
+DECLARE_MEMORY_STAT(TEXT("Tile Arena Capacity"), STAT_WorldGen_ArenaCapacity, STATGROUP_WorldGenerator);
+
+static const TCHAR* GetTileStageName(ETileStage Stage)
 {
-public:
-	/** Creates and initializes a new instance. */
-	FPCGAsyncGraphTask(ENamedThreads::Type InDesiredThread, TUniqueFunction<void()>&& InFunction)
-			: DesiredThread(InDesiredThread)
-			, Function(MoveTemp(InFunction))
-	{
+	switch (Stage)
+	{
+		case ETileStage::Heights:
+			return TEXT("Heights");
+		case ETileStage::Normals:
+			return TEXT("Normals");
+		case ETileStage::Points:
+			return TEXT("Points");
+		case ETileStage::Plans:
+			return TEXT("Plans");
+		case ETileStage::GroundMesh:
+			return TEXT("GroundMesh");
+		case ETileStage::Barriers:
+			return TEXT("Barriers");
+		default:
+			return TEXT("Unknown");
 	}
+}
 
-	/** Performs the actual task. */
-	void DoTask(ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+// 记录一个阶段的耗时，同一个阶段执行多次时（例如每个 spawner 一次）耗时会累加
+struct FScopedTileStageTimer
+{
+	FScopedTileStageTimer(FTileStageTimings& InTimings, ETileStage InStage)
+			: Timings(InTimings)
+			, Stage(InStage)
+			, StartTime(FPlatformTime::Seconds())
 	{
-		Function();
 	}
-
-	/** Returns the name of the thread that this task should run on. */
-	ENamedThreads::Type GetDesiredThread()
+	~FScopedTileStageTimer()
 	{
-		return DesiredThread;
+		Timings.Seconds[(int32)Stage] += FPlatformTime::Seconds() - StartTime;
 	}
 
-private:
-	/** The thread to execute the function on. */
-	ENamedThreads::Type DesiredThread;
-
-	/** The function to execute on the Task Graph. */
-	TUniqueFunction<void()> Function;
+	FTileStageTimings& Timings;
+	ETileStage Stage;
+	double StartTime;
 };
 
 static constexpr int32 MaxForwardTileNumber = 3; // 前方最多生成的 Tile 数量
@@ -84,6 +107,12 @@ AWorldGenerator::AWorldGenerator()
 {
 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
+	// 主 tick 只派发任务，尽早开始让 worker 和物理并行
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+	// 提交、spawn 和移动原点放到所有移动更新之后
+	CommitTick.bCanEverTick = true;
+	CommitTick.bStartWithTickEnabled = true;
+	CommitTick.TickGroup = TG_PostUpdateWork;
 	// ProceduralMeshComp = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("ProceduralMeshComp"));
 	// RootComponent = ProceduralMeshComp;
 	// ProceduralMeshComp->bUseAsyncCooking = true;
@@ -105,6 +134,9 @@ void AWorldGenerator::BeginPlay()
 {
 	InitDataBuffer();
 	SortBarrierSpawners();
+	BuildGameThreadStages();
+	StartGenerationThreads();
+	UpdateTickPrerequisites();
 	// SpawnBarrierSpawners();
 
 	// Set EvilPos to minimum double
@@ -122,6 +154,8 @@ void AWorldGenerator::BeginPlay()
 	{
 		auto PlayerStart = *It;
 		PlayerStartTile = GetTileFromHorizontalPos(FVector2D(PlayerStart->GetActorLocation()));
+		// PlayerStartTile 不随原点移动，绝对编号只能在这里记录一次
+		PlayerStartAbsoluteTile = GetAbsoluteTile(PlayerStartTile);
 	}
 
 	// 使用全局的种子来控制地形和障碍物的随机生成
@@ -140,6 +174,8 @@ void AWorldGenerator::BeginPlay()
 	}
 	PerlinCosTheta = FMath::Cos(FMath::DegreesToRadians(Theta));
 	PerlinSinTheta = FMath::Sin(FMath::DegreesToRadians(Theta));
+	BuildPointSetLibraries();
+	RebuildGenConfig();
 
 	UE_LOG(LogWorldGenerator, Log, TEXT("RandomSeed, Theta: %d, Offset: %s, BarrierRandom: %d"),
 			Theta, *PerlinOffset.ToString(), BarrierRandom);
@@ -184,24 +220,177 @@ void AWorldGenerator::SortBarrierSpawners()
 	ensure(BarrierSpawners[0]->IsA(AGoldCoinSpawner::StaticClass()));
 }
 
+void AWorldGenerator::BuildGameThreadStages()
+{
+	GameThreadStages.Reset();
+	// 先创建地形网格，障碍物的位置依赖地形
+	GameThreadStages.Add({ ETileStage::GroundMesh, [this](int32 BufferIndex, FSpawnBudget& Budget) {
+		SCOPE_CYCLE_COUNTER(STAT_WorldGen_GroundMesh);
+		CreateGroundMesh(BufferIndex);
+		Budget.ConsumeAll(); // 地形网格无法拆分，本帧不再做其它工作
+		return true;
+	} });
+	// 每个 spawner 单独一个阶段，spawner 内部按预算跨帧执行
+	for (int32 BarrierIndex = 0; BarrierIndex < BarrierSpawners.Num(); ++BarrierIndex)
+	{
+		GameThreadStages.Add({ ETileStage::Barriers, [this, BarrierIndex](int32 BufferIndex, FSpawnBudget& Budget) {
+			SCOPE_CYCLE_COUNTER(STAT_WorldGen_Barriers);
+			return CreateBarriers(BufferIndex, BarrierIndex, Budget);
+		} });
+	}
+}
+
+void AWorldGenerator::StartGenerationThreads()
+{
+	if (!bUseDedicatedGenerationThreads || !FPlatformProcess::SupportsMultithreading())
+	{
+		return;
+	}
+
+	EThreadPriority Priority = TPri_Normal;
+	switch (GenerationThreadPriority)
+	{
+		case EGenerationThreadPriority::Lowest:
+			Priority = TPri_Lowest;
+			break;
+		case EGenerationThreadPriority::BelowNormal:
+			Priority = TPri_BelowNormal;
+			break;
+		case EGenerationThreadPriority::AboveNormal:
+			Priority = TPri_AboveNormal;
+			break;
+		default:
+			break;
+	}
+
+	auto ThreadCount = FMath::Clamp(GenerationThreadCount, 1, MaxThreadCount);
+	for (int32 i = 0; i < ThreadCount; ++i)
+	{
+		// 每个 slot 同时最多只有一个请求，因此队列容量为 MaxThreadCount 就足够了
+		auto Worker = MakeUnique<FPCGWorker>([this](const FPCGRequest& Request) { ExecuteWorkerStages(Request); }, MaxThreadCount);
+		if (Worker->Start(*FString::Printf(TEXT("WorldGenThread_%d"), i), Priority, uint64(GenerationThreadAffinityMask)))
+		{
+			PCGWorkers.Add(MoveTemp(Worker));
+		}
+	}
+	UE_LOG(LogWorldGenerator, Log, TEXT("Started %d world generation threads"), PCGWorkers.Num());
+}
+
+void AWorldGenerator::StopGenerationThreads()
+{
+	// 等待正在执行的请求完成，队列中剩余的请求不再执行，但要触发 WorkerDone，否则依赖它的 Handoff 永远不会完成
+	for (auto& Worker : PCGWorkers)
+	{
+		Worker->Shutdown([this](const FPCGRequest& Request) {
+			auto& Pipeline = Pipelines[Request.BufferIndex];
+			if (Pipeline.WorkerDone.IsSet())
+			{
+				Pipeline.WorkerDone->Trigger();
+			}
+		});
+	}
+	PCGWorkers.Empty();
+	NextPCGWorker = 0;
+}
+
 void AWorldGenerator::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
+	StopGenerationThreads();
+	// 只等待 worker 阶段，Handoff 固定在 game 线程上，在这里等待它会死锁
 	for (int i = 0; i < MaxThreadCount; ++i)
 	{
-		if (AsyncTaskRef[i].IsValid())
+		auto& Pipeline = Pipelines[i];
+		if (Pipeline.Normals.IsValid())
+		{
+			Pipeline.Normals.Wait();
+		}
+		if (Pipeline.Plans.IsValid())
+		{
+			Pipeline.Plans.Wait(); // Plans 依赖 Normals 和 Points
+		}
+		Pipeline = FTilePipeline();
+	}
+}
+
+void FWorldGeneratorCommitTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && IsValidChecked(Target) && !Target->IsUnreachable())
+	{
+		if (TickType != LEVELTICK_ViewportsOnly || Target->ShouldTickIfViewportsOnly())
+		{
+			Target->TickPostUpdateWork(DeltaTime * Target->CustomTimeDilation);
+		}
+	}
+}
+
+FString FWorldGeneratorCommitTickFunction::DiagnosticMessage()
+{
+	return Target ? Target->GetFullName() + TEXT("[CommitTick]") : TEXT("<NULL>[CommitTick]");
+}
+
+FName FWorldGeneratorCommitTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return Target ? Target->GetClass()->GetFName() : NAME_None;
+}
+
+void AWorldGenerator::RegisterActorTickFunctions(bool bRegister)
+{
+	Super::RegisterActorTickFunctions(bRegister);
+	if (bRegister)
+	{
+		if (CommitTick.bCanEverTick)
 		{
-			AsyncTaskRef[i]->Wait();
-			AsyncTaskRef[i]->Release();
-			AsyncTaskRef[i] = nullptr;
+			CommitTick.Target = this;
+			CommitTick.SetTickFunctionEnable(CommitTick.bStartWithTickEnabled);
+			CommitTick.RegisterTickFunction(GetLevel());
 		}
 	}
+	else if (CommitTick.IsTickFunctionRegistered())
+	{
+		CommitTick.UnRegisterTickFunction();
+	}
+}
+
+void AWorldGenerator::UpdateTickPrerequisites()
+{
+	auto* Character = UGameplayStatics::GetPlayerCharacter(this, 0);
+	if (Character == TickPrerequisiteCharacter.Get())
+	{
+		return;
+	}
+	if (auto* OldCharacter = TickPrerequisiteCharacter.Get())
+	{
+		RemoveTickPrerequisiteComponent(OldCharacter->GetCharacterMovement());
+	}
+	TickPrerequisiteCharacter = Character;
+	// GetPlayerTile 读取角色位置，派发必须在角色移动之后
+	if (Character && Character->GetCharacterMovement())
+	{
+		AddTickPrerequisiteComponent(Character->GetCharacterMovement());
+	}
 }
 
 // Called every frame
 void AWorldGenerator::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	if (bWorldReady)
+	{
+		DispatchNewTiles();
+	}
+}
+
+void AWorldGenerator::TickPostUpdateWork(float DeltaTime)
+{
+	// 角色可能被重新 possess，新的依赖在下一帧生效
+	UpdateTickPrerequisites();
+	if (!bWorldReady)
+	{
+		// 所有 spawner 的 BeginPlay 都已经执行过了，可以安全地 spawn 障碍物
+		WarmStart();
+		return;
+	}
 	// World 移动之后才调用 UpdateEvilPos
 	auto bMoved = ConditionalMoveWorldOrigin();
 	if (bGameStart)
@@ -215,7 +404,7 @@ void AWorldGenerator::Tick(float DeltaTime)
 	}
 	if (!bMoved)
 	{
-		GenerateNewTiles();
+		CommitGeneratedTiles();
 	}
 
 	if (bDebugPrint)
@@ -246,6 +435,16 @@ void AWorldGenerator::UpdateEvilPos(float DeltaTime)
 }
 void AWorldGenerator::DebugPrint() const
 {
+	if (CompletedTileCount > 0)
+	{
+		FString StageInfo;
+		for (int32 Stage = 0; Stage < (int32)ETileStage::Num; ++Stage)
+		{
+			StageInfo += FString::Printf(TEXT("%s: %.3fms "), GetTileStageName(ETileStage(Stage)), StageTimeTotals.Seconds[Stage] * 1000.0 / CompletedTileCount);
+		}
+		UE_LOG(LogWorldGenerator, Log, TEXT("Average stage time of %d tiles, %s, tile heap allocations: %u"), CompletedTileCount, *StageInfo, TileHeapAllocations);
+	}
+
 	auto* Character = UGameplayStatics::GetPlayerCharacter(this, 0);
 	if (!Character)
 	{
@@ -415,7 +614,9 @@ void AWorldGenerator::InitDataBuffer()
 		TaskDataBuffers[i].NormalsBuffer.SetNumUninitialized((XCellNumber + 1) * (YCellNumber + 1));
 		TaskDataBuffers[i].UV0Buffer.SetNumUninitialized((XCellNumber + 1) * (YCellNumber + 1));
 		TaskDataBuffers[i].TangentsBuffer.SetNumUninitialized((XCellNumber + 1) * (YCellNumber + 1));
+		TaskDataBuffers[i].TangentSums.SetNumUninitialized((XCellNumber + 1) * (YCellNumber + 1) * 3);
 		TaskDataBuffers[i].BarriersCount.SetNumUninitialized(BarrierSpawners.Num());
+		TaskDataBuffers[i].SpawnPlans.SetNum(BarrierSpawners.Num());
 	}
 
 	TrianglesBuffer.SetNumUninitialized(XCellNumber * YCellNumber * 6);
@@ -437,6 +638,8 @@ void AWorldGenerator::InitDataBuffer()
 			TrianglesBuffer[Index + 5] = ((Y + 1) * (XCellNumber + 1)) + X;
 		}
 	}
+	SharedTriangles = MakeShared<const TArray<int32>>(TrianglesBuffer);
+
 	UV1Buffer.SetNumUninitialized((XCellNumber + 1) * (YCellNumber + 1));
 	for (int32 Y = 0; Y <= YCellNumber; ++Y)
 	{
@@ -510,7 +713,71 @@ bool AWorldGenerator::CanRemoveTile(FInt32Point Tile) const
 	return true;
 }
 
-FVector2D AWorldGenerator::GetUVFromPosAnyThread(FVector Position) const
+int32 AWorldGenerator::GetMaxResidentTileNumber() const
+{
+	// 和 CanRemoveTile 保持一致，再加上玩家身后等待移除的一个 tile
+	return bOneLineMode ? MaxForwardTileNumber + 3 : 5 * 5;
+}
+
+int32 FSpawnerGenConfig::GetBarrierCount(double RandomValue, int32 Difficulty) const
+{
+	ensure(MinBarrierCount.Num() > 0 && MaxBarrierCount.Num() > 0);
+	auto MinCount = MinBarrierCount.IsValidIndex(Difficulty) ? MinBarrierCount[Difficulty] : MinBarrierCount[MinBarrierCount.Num() - 1];
+	auto MaxCount = MaxBarrierCount.IsValidIndex(Difficulty) ? MaxBarrierCount[Difficulty] : MaxBarrierCount[MaxBarrierCount.Num() - 1];
+
+	if (MaxCount <= 0)
+	{
+		return 0;
+	}
+	auto BarCount = FMath::RoundToInt(float(FMath::Lerp(MinCount, MaxCount, RandomValue)));
+	// 当 MaxCount 大于 0 时，确保至少生成一个障碍物
+	return FMath::Max(BarCount, 1);
+}
+
+void AWorldGenerator::RebuildGenConfig(bool bRebuildPointSets)
+{
+	check(IsInGameThread());
+	if (bRebuildPointSets)
+	{
+		BuildPointSetLibraries();
+	}
+
+	auto Config = MakeShared<FWorldGenConfig>();
+	Config->Version = ++NextGenConfigVersion;
+	Config->CellSize = CellSize;
+	Config->XCellNumber = XCellNumber;
+	Config->YCellNumber = YCellNumber;
+	Config->WorldOriginOffset = WorldOriginOffset;
+	Config->TextureSize = TextureSize;
+	Config->MaxTextureCoords = MaxTextureCoords;
+	Config->PerlinFreq = PerlinFreq;
+	Config->PerlinAmplitude = PerlinAmplitude;
+	Config->PerlinCosTheta = PerlinCosTheta;
+	Config->PerlinSinTheta = PerlinSinTheta;
+	// 编辑器预览不压平
+	Config->bFlattenStartTile = bEnablePostProcessHeightMap && GetWorld() && GetWorld()->IsGameWorld();
+	Config->StartTile = PlayerStartAbsoluteTile;
+
+	Config->SampleCountBeforeReject = SampleCountBeforeReject;
+	Config->bCheckPoissonSampling = bCheckPoissonSampling;
+	Config->GroupDistanceFunc = GroupDistanceFunc;
+	Config->Spawners.Reserve(BarrierSpawners.Num());
+	for (ABarrierSpawner* Spawner : BarrierSpawners)
+	{
+		auto& SpawnerConfig = Config->Spawners.AddDefaulted_GetRef();
+		if (!Spawner)
+		{
+			continue; // 编辑器中可能还没有设置
+		}
+		Spawner->FillGenConfig(SpawnerConfig);
+	}
+
+	Config->Triangles = SharedTriangles;
+	Config->PointSetLibraries = PointSetLibraries;
+	GenConfig = MoveTemp(Config);
+}
+
+FVector2D FWorldGenConfig::GetUVFromPos(FVector Position) const
 {
 	// 根据世界坐标偏移计算真实的世界坐标
 	Position.X += WorldOriginOffset.X;
@@ -535,7 +802,7 @@ FVector2D AWorldGenerator::GetUVFromPosAnyThread(FVector Position) const
 	return FVector2D(X, Y);
 }
 
-double AWorldGenerator::GetHeightFromPerlinAnyThread(FVector2D Pos, FInt32Point CellPos) const
+double FWorldGenConfig::GetHeightFromPerlin(FVector2D Pos, FInt32Point CellPos) const
 {
 	if (PerlinAmplitude.Num() != PerlinFreq.Num())
 	{
@@ -563,6 +830,29 @@ double AWorldGenerator::GetHeightFromPerlinAnyThread(FVector2D Pos, FInt32Point
 	return Height;
 }
 
+double FWorldGenConfig::GetVertexHeight(FInt32Point Tile, int32 X, int32 Y) const
+{
+	auto Pos = FVector2D(double(X) * CellSize + Tile.X * GetTileSizeX(), double(Y) * CellSize + Tile.Y * GetTileSizeY());
+	// 噪声的偏移使用绝对 tile 编号，移动原点前后生成的相邻 tile 在边界上的高度一致
+	auto AbsoluteTile = FInt32Point(Tile.X + GetOriginTileX(), Tile.Y);
+	auto Height = GetHeightFromPerlin(Pos, FInt32Point(AbsoluteTile.X * XCellNumber + X, AbsoluteTile.Y * YCellNumber + Y));
+	if (!bFlattenStartTile || AbsoluteTile != StartTile)
+	{
+		return Height;
+	}
+
+	// 我们假设玩家位于 tile 中心，然后设置该中心的高度为 0，渐渐向四周扩散，高度图逐渐恢复到原来的高度
+	auto CenterX = XCellNumber / 2;
+	auto CenterY = YCellNumber / 2;
+	auto MaxDist = FMath::Min(CenterX, CenterY);
+	auto Dist = FMath::Max(FMath::Abs(X - CenterX), FMath::Abs(Y - CenterY));
+	if (Dist >= MaxDist)
+	{
+		return Height;
+	}
+	return Height * (Dist * (1.0 / MaxDist));
+}
+
 FVector AWorldGenerator::GetNormalFromHorizontalPos(FVector2D Pos) const
 {
 	FInt32Point Tile;
@@ -615,51 +905,6 @@ FVector AWorldGenerator::GetNormalFromUVandTile(FVector2D UV, FInt32Point Tile)
 	return GetNormalFromHorizontalPos(Pos);
 }
 
-void AWorldGenerator::PostProcessHeightMap(FInt32Point Tile, TArray<FVector>& VerticesBuffer)
-{
-	if (Tile != PlayerStartTile || !bEnablePostProcessHeightMap || WorldOriginOffset.X != 0.0)
-	{
-		return;
-	}
-	// 我们假设玩家位于 tile 中心，然后设置该中心的高度为 0，渐渐向四周扩散，高度图逐渐恢复到原来的高度
-	auto CenterX = XCellNumber / 2;
-	auto CenterY = YCellNumber / 2;
-
-	auto MaxDist = FMath::Min(CenterX, CenterY);
-	auto DeltaAlpha = 1.0 / MaxDist;
-	for (auto Dist = 0; Dist < MaxDist; ++Dist)
-	{
-		auto Alpha = Dist * DeltaAlpha;
-		auto MinX = CenterX - Dist;
-		auto MaxX = CenterX + Dist;
-		auto MinY = CenterY - Dist;
-		auto MaxY = CenterY + Dist;
-		for (int32 X = MinX + 1; X < MaxX; ++X)
-		{
-			auto Pos1 = MinY * (XCellNumber + 1) + X;
-			auto Pos2 = MaxY * (XCellNumber + 1) + X;
-			VerticesBuffer[Pos1].Z = VerticesBuffer[Pos1].Z * Alpha;
-			VerticesBuffer[Pos2].Z = VerticesBuffer[Pos2].Z * Alpha;
-		}
-		for (int32 Y = MinY + 1; Y < MaxY; ++Y)
-		{
-			auto Pos1 = Y * (XCellNumber + 1) + MinX;
-			auto Pos2 = Y * (XCellNumber + 1) + MaxX;
-			VerticesBuffer[Pos1].Z = VerticesBuffer[Pos1].Z * Alpha;
-			VerticesBuffer[Pos2].Z = VerticesBuffer[Pos2].Z * Alpha;
-		}
-		// 单独处理四个角，避免它们被 alpha 乘多次，中心高度为 0，被乘多次也无所谓
-		auto PosTopLeft = MinY * (XCellNumber + 1) + MinX;
-		auto PosTopRight = MinY * (XCellNumber + 1) + MaxX;
-		auto PosBottomLeft = MaxY * (XCellNumber + 1) + MinX;
-		auto PosBottomRight = MaxY * (XCellNumber + 1) + MaxX;
-		VerticesBuffer[PosTopLeft].Z = VerticesBuffer[PosTopLeft].Z * Alpha;
-		VerticesBuffer[PosTopRight].Z = VerticesBuffer[PosTopRight].Z * Alpha;
-		VerticesBuffer[PosBottomLeft].Z = VerticesBuffer[PosBottomLeft].Z * Alpha;
-		VerticesBuffer[PosBottomRight].Z = VerticesBuffer[PosBottomRight].Z * Alpha;
-	}
-}
-
 void AWorldGenerator::CreateGroundMesh(int32 BufferIndex)
 {
 	auto& TaskData = TaskDataBuffers[BufferIndex];
@@ -669,7 +914,6 @@ void AWorldGenerator::CreateGroundMesh(int32 BufferIndex)
 	auto& TangentsBuffer = TaskData.TangentsBuffer;
 
 	auto Tile = TilesInBuilding[BufferIndex];
-	PostProcessHeightMap(Tile, VerticesBuffer);
 
 	int32 PMCIndex = PMCIndexForTile[BufferIndex];
 	UProceduralMeshComponent* PMC = ProceduralMeshComp[PMCIndex];
@@ -707,93 +951,127 @@ void AWorldGenerator::CreateGroundMesh(int32 BufferIndex)
 			{
 				BarrierSpawner->RemoveTile(OldTile);
 			}
-			RemoveSpecialLaserPos(OldTile.X);	
+			RemoveTileExclusions(OldTile);
 		}
 		PMC->CreateMeshSection(SectionIdx, VerticesBuffer, TrianglesBuffer, NormalsBuffer, UV0Buffer, UV1Buffer, TArray<FVector2D>(), TArray<FVector2D>(), TArray<FColor>(), TangentsBuffer, true);
 		PMC->SetMaterial(SectionIdx, DynamicMat);
 
 		TileMap[PMCIndex][SectionIdx] = Tile;
 		UE_LOG(LogWorldGenerator, Log, TEXT("Tile %s replaced with new tile %s in PMC %d"), *OldTile.ToString(), *Tile.ToString(), PMCIndex);
-		// 删除 CachedSpawnData 中对应 tile 的数据
-		auto RemoveNumber = CachedSpawnData.Remove(FIntVector(OldTile.X, OldTile.Y, PMCIndex));
-		if (RemoveNumber > 0)
-		{
-			UE_LOG(LogWorldGenerator, Warning, TEXT("Spawner %d, tile %s removed from CachedSpawnData before used!"), PMCIndex, *FIntVector(OldTile.X, OldTile.Y, PMCIndex).ToString());
-		}
+		DropDeferredSpawns(OldTile);
 	}
 }
 
-void AWorldGenerator::CreateBarriers(int32 BufferIndex, int32 BarrierIndex)
+bool AWorldGenerator::CreateBarriers(int32 BufferIndex, int32 BarrierIndex, FSpawnBudget& Budget)
 {
 	auto& TaskData = TaskDataBuffers[BufferIndex];
-	auto& VerticesBuffer = TaskData.VerticesBuffer;
-	auto& NormalsBuffer = TaskData.NormalsBuffer;
-	auto& UV0Buffer = TaskData.UV0Buffer;
-	auto& TangentsBuffer = TaskData.TangentsBuffer;
-	auto& RandomPoints = TaskData.RandomPoints;
+	auto& SpawnSeeds = TaskData.SpawnSeeds;
 	auto& BarriersCount = TaskData.BarriersCount;
+	auto& Pipeline = Pipelines[BufferIndex];
 	auto Tile = TilesInBuilding[BufferIndex];
 
 	int32 StartIdx = 0;
-	for (int32 Idx = 0, TotalBarrier = BarrierSpawners.Num(); Idx <= BarrierIndex && Idx < TotalBarrier; ++Idx)
+	for (int32 Idx = 0; Idx < BarrierIndex; ++Idx)
 	{
-		int32 BarCount = BarriersCount[Idx];
-		if (BarCount > 0 && Idx == BarrierIndex)
-		{
-			TArrayView<RandomPoint> RandomPointsView(&RandomPoints[StartIdx], BarCount);
-			if (BarrierSpawners[Idx]->bDeferSpawn)
-			{
-				auto PosUV = BarrierSpawners[Idx]->PreSpawnBarriers(RandomPointsView, Tile, this);
-				auto Key = FIntVector(Tile.X, Tile.Y, Idx);
-				CachedSpawnData.Add(Key, TPair<TArray<RandomPoint>, FVector2D>(TArray<RandomPoint>(RandomPointsView), PosUV));
-			}
-			else
-			{
-				BarrierSpawners[Idx]->SpawnBarriers(RandomPointsView, Tile, this);
-			}
-		}
-		StartIdx += BarCount;
+		StartIdx += BarriersCount[Idx];
+	}
+
+	int32 BarCount = BarriersCount[BarrierIndex];
+	if (BarCount <= 0)
+	{
+		return true;
+	}
+
+	auto SeedsView = SpawnSeeds.Slice(StartIdx, BarCount);
+	if (BarrierSpawners[BarrierIndex]->bDeferSpawn)
+	{
+		const auto& Plan = TaskData.SpawnPlans[BarrierIndex];
+		auto KeepOutUV = BarrierSpawners[BarrierIndex]->PreSpawnBarriers(SeedsView, Tile, Plan, this);
+		AddDeferredSpawn(Tile, BarrierIndex, SeedsView, Plan);
+		ExclusionIndex.AddBox(Tile, KeepOutUV, DeferredKeepOutHalfExtent);
+		Budget.Consume();
+		return true;
 	}
+
+	FBarrierSpawnContext Context;
+	Context.Positions = SeedsView;
+	Context.Tile = Tile;
+	Context.WorldGenerator = this;
+	Context.Budget = &Budget;
+	Context.SpawnerIndex = BarrierIndex;
+	Context.Plan = &TaskData.SpawnPlans[BarrierIndex];
+	Context.Cursor = Pipeline.StageCursor;
+	Context.SpawnerState = Pipeline.StageState;
+	Context.bResumed = Pipeline.bStageStarted;
+
+	auto bFinished = BarrierSpawners[BarrierIndex]->SpawnBarriers(Context);
+
+	Pipeline.StageCursor = Context.Cursor;
+	Pipeline.StageState = Context.SpawnerState;
+	return bFinished;
 }
 
 bool AWorldGenerator::CreateMeshFromTileData()
+{
+	FSpawnBudget Budget(MaxSpawnInstancesPerFrame, SpawnBudgetMicroseconds);
+	return RunGameThreadStages(Budget);
+}
+
+bool AWorldGenerator::RunGameThreadStages(FSpawnBudget& Budget)
 {
 	auto bHasAnyWork = false;
-	for (int32 i = 0; i < MaxThreadCount; ++i)
+	auto PlayerTile = GetPlayerTile();
+	while (!Budget.IsExhausted())
 	{
-		if (BufferStateGameThreadOnly[i] == EBufferState::Completed)
+		// 优先处理离玩家最近的 tile，避免玩家前方的障碍物被远处的 tile 拖慢
+		int32 BufferIndex = INDEX_NONE;
+		int32 BestDistance = MAX_int32;
+		for (int32 i = 0; i < MaxThreadCount; ++i)
 		{
-			if (TileCreationState[i] == 0)
+			if (BufferStateGameThreadOnly[i] != EBufferState::Completed)
 			{
-				// 创建地形网格
-				CreateGroundMesh(i);
-				TileCreationState[i] = 1; // 标记为地形网格已创建
-				bHasAnyWork = true;
+				continue;
 			}
-			else if (TileCreationState[i] <= BarrierSpawners.Num())
+			auto Distance = FMath::Abs(TilesInBuilding[i].X - PlayerTile.X) + FMath::Abs(TilesInBuilding[i].Y - PlayerTile.Y);
+			if (Distance < BestDistance)
 			{
-				// 创建障碍物
-				int32 BarrierIndex = TileCreationState[i] - 1; // BarrierIndex 从 0 开始
-				CreateBarriers(i, BarrierIndex);
-				TileCreationState[i]++; // 标记为下一个障碍物已创建
-				bHasAnyWork = true;
+				BestDistance = Distance;
+				BufferIndex = i;
 			}
+		}
+		if (BufferIndex == INDEX_NONE)
+		{
+			break;
+		}
 
-			if (TileCreationState[i] == BarrierSpawners.Num() + 1)
+		auto& Pipeline = Pipelines[BufferIndex];
+		if (GameThreadStages.IsValidIndex(Pipeline.NextGameThreadStage))
+		{
+			const auto& Stage = GameThreadStages[Pipeline.NextGameThreadStage];
+			bool bStageFinished;
 			{
-				// 所有障碍物都已创建，重置状态
-				TileCreationState[i] = 0;
-				// 释放 slot
-				BufferStateGameThreadOnly[i] = EBufferState::Idle; // Reset the buffer state
-				// if (AsyncTaskRef[i])
-				{
-					AsyncTaskRef[i]->Release();
-					AsyncTaskRef[i] = nullptr;
-				}
-				TilesInBuilding[i] = FInt32Point(INT32_MAX, INT32_MAX); // Reset the tile in building
+				FScopedTileStageTimer Timer(Pipeline.Timings, Stage.Stage);
+				bStageFinished = Stage.Run(BufferIndex, Budget);
+			}
+			// 预算可能在进入阶段之后、处理第一个点之前耗尽，此时 Cursor 仍为 0，但阶段已经开始
+			Pipeline.bStageStarted = true;
+			if (bStageFinished)
+			{
+				Pipeline.NextGameThreadStage++;
+				Pipeline.StageCursor = 0;
+				Pipeline.StageState = 0;
+				Pipeline.bStageStarted = false;
 			}
+			bHasAnyWork = true;
+		}
+
+		if (!GameThreadStages.IsValidIndex(Pipeline.NextGameThreadStage))
+		{
+			// 所有阶段都已完成，释放 slot
+			auto CommittedTile = TilesInBuilding[BufferIndex];
+			ReleaseBuffer(BufferIndex);
+			OnTileCommitted(CommittedTile);
 
-			break;
 			// 可视化采样点
 			// if (bDrawSamplingPoint && Tile.X == 50)
 			// {
@@ -877,36 +1155,11 @@ void AWorldGenerator::PMCClear(int32 ReplaceableIndex)
 		{
 			Spawner->RemoveTile(Tile);
 		}
-		RemoveSpecialLaserPos(Tile.X);
+		RemoveTileExclusions(Tile);
+		DropDeferredSpawns(Tile);
 	}
 	UE_LOG(LogWorldGenerator, Log, TEXT("Clearing PMC %d, removing %d tiles"), ReplaceableIndex, TileMap[ReplaceableIndex].Num());
 	TileMap[ReplaceableIndex].Empty(); // Clear the tile map for this PMC
-
-	// 删除 CachedSpawnData 中对应 tile 的数据
-	for (auto It = CachedSpawnData.CreateIterator(); It; ++It)
-	{
-		if (It.Key().Z == ReplaceableIndex)
-		{
-			UE_LOG(LogWorldGenerator, Warning, TEXT("Spawner %d, tile %s removed from CachedSpawnData before used!"), It.Key().Z, *FIntVector(It.Key()).ToString());
-			It.RemoveCurrent();
-		}
-	}
-}
-
-// See https://stackoverflow.com/questions/664014/what-integer-hash-function-are-good-that-accepts-an-integer-hash-key
-static inline uint32 int32HashFunc(uint32 x)
-{
-	x = ((x >> 16) ^ x) * 0x45d9f3bu;
-	x = ((x >> 16) ^ x) * 0x45d9f3bu;
-	x = (x >> 16) ^ x;
-	return x;
-}
-
-static int64 GetSeedFromTile(FInt32Point Tile, int32 BarrierRandom)
-{
-	auto X = int32HashFunc(Tile.X);
-	int64 Seed = (uint64(X) << 32) | uint64(uint32(BarrierRandom));
-	return Seed;
 }
 
 bool AWorldGenerator::GenerateOneTile(FInt32Point Tile)
@@ -934,29 +1187,207 @@ bool AWorldGenerator::GenerateOneTile(FInt32Point Tile)
 		return false; // All buffers are busy
 	}
 
-	double XOffset = (double)Tile.X * CellSize * XCellNumber;
-	double YOffset = (double)Tile.Y * CellSize * YCellNumber;
-
-	auto TestPos = FVector2D(XOffset + (double)CellSize * XCellNumber / 2.0, YOffset + (double)CellSize * YCellNumber / 2.0);
 	UProceduralMeshComponent* PMC = nullptr;
 	int32 PMCIndex = -1;
 	Tie(PMC, PMCIndex) = GetActivePMC();
 
 	auto PosOffset = FVector2D(PMC->GetComponentLocation());
-	auto Seed = GetSeedFromTile(Tile, BarrierRandom);
+	// 随机数由 (种子, tile, 用途, 下标) 直接计算，使用移动原点之前的绝对 tile 编号，保证同一个种子的世界完全一致
+	int64 Seed = uint32(BarrierRandom);
+	auto RandomTile = GetAbsoluteTile(Tile);
+
+	auto& Pipeline = Pipelines[BufferIndex];
+	Pipeline = FTilePipeline();
+	Pipeline.Serial = ++NextPipelineSerial;
+	// worker 只读取派发时的快照，之后移动原点或修改参数不会影响这个 tile
+	auto Config = GetGenConfig();
+
+	if (PCGWorkers.Num() > 0 && !bWarmStarting)
+	{
+		// 专用生成线程上依次执行所有 worker 阶段，不同 slot 的 tile 分配给不同的线程
+		Pipeline.WorkerDone.Emplace(TEXT("WorldGen.WorkerDone"));
+		FPCGRequest Request;
+		Request.BufferIndex = BufferIndex;
+		Request.Tile = Tile;
+		Request.PositionOffset = PosOffset;
+		Request.Difficulty = CurrentDifficulty;
+		Request.Seed = Seed;
+		Request.RandomTile = RandomTile;
+		Request.Config = Config;
+		auto bSubmitted = PCGWorkers[NextPCGWorker]->Submit(Request);
+		NextPCGWorker = (NextPCGWorker + 1) % PCGWorkers.Num();
+		if (!ensure(bSubmitted))
+		{
+			Pipeline = FTilePipeline();
+			BufferStateGameThreadOnly[BufferIndex] = EBufferState::Idle;
+			return false;
+		}
+	}
+	else
+	{
+		// 高度图 -> 法线，撒点不依赖地形，与它们并行执行
+		Pipeline.Heights = UE::Tasks::Launch(TEXT("WorldGen.Heights"), [this, Config, BufferIndex, Tile, PosOffset]() {
+			SCOPE_CYCLE_COUNTER(STAT_WorldGen_Heights);
+			FScopedTileStageTimer Timer(Pipelines[BufferIndex].Timings, ETileStage::Heights);
+			GenerateHeightsAsync(*Config, BufferIndex, Tile, PosOffset);
+		});
+
+		// 法线读取 slot 中的高度图，依赖关系只由 Prerequisites 保证
+		Pipeline.Normals = UE::Tasks::Launch(TEXT("WorldGen.Normals"), [this, Config, BufferIndex]() {
+			SCOPE_CYCLE_COUNTER(STAT_WorldGen_Normals);
+			FScopedTileStageTimer Timer(Pipelines[BufferIndex].Timings, ETileStage::Normals);
+			return GenerateNormalsAsync(*Config, BufferIndex);
+		}, UE::Tasks::Prerequisites(Pipeline.Heights));
+
+		// 因为 Difficulty 在 game 线程中不断被访问和修改，因此这里我们将当前的 Difficulty 直接传递给 worker
+		// 撒点的随机性依赖于 Tile 编号，因此这里使用真实的 Tile 编号
+		Pipeline.Points = UE::Tasks::Launch(TEXT("WorldGen.Points"), [this, Config, BufferIndex, RandomTile, Difficulty = this->CurrentDifficulty, Seed]() {
+			SCOPE_CYCLE_COUNTER(STAT_WorldGen_Points);
+			FScopedTileStageTimer Timer(Pipelines[BufferIndex].Timings, ETileStage::Points);
+			auto& SpawnSeeds = TaskDataBuffers[BufferIndex].SpawnSeeds;
+			GenerateRandomPointsAsync(*Config, Seed, BufferIndex, Difficulty, RandomTile, SpawnSeeds);
+			return FPointStageOutput{ SpawnSeeds.Num() };
+		});
+
+		// 规划需要同时读取高度图、法线和撒点结果
+		Pipeline.Plans = UE::Tasks::Launch(TEXT("WorldGen.Plans"), [this, Config, BufferIndex, Tile, RandomTile, Seed]() {
+			SCOPE_CYCLE_COUNTER(STAT_WorldGen_SpawnPlans);
+			FScopedTileStageTimer Timer(Pipelines[BufferIndex].Timings, ETileStage::Plans);
+			PlanSpawnersAsync(*Config, Seed, BufferIndex, Tile, RandomTile);
+		}, UE::Tasks::Prerequisites(Pipeline.Normals, Pipeline.Points));
+	}
 
-	// 因为 Difficulty 在 game 线程中不断被访问和修改，因此这里我们将当前的 Difficulty 直接传递给 worker
-	// 撒点的随机性依赖于 Tile 编号，因此这里使用真实的 Tile 编号
-	auto Lambda = [this, PosOffset, Tile, BufferIndex, Difficulty = this->CurrentDifficulty, Seed]() {
-		// Generate the tile mesh data
-		GenerateOneTileAsync(Seed, BufferIndex, Difficulty, Tile, PosOffset);
+	// Game 线程的回调
+	auto Handoff = [WeakThis = TWeakObjectPtr<AWorldGenerator>(this), BufferIndex, Serial = Pipeline.Serial]() {
+		if (auto* This = WeakThis.Get())
+		{
+			This->OnWorkerStagesCompleted(BufferIndex, Serial);
+		}
 	};
-	AsyncTaskRef[BufferIndex] = TGraphTask<FPCGAsyncGraphTask>::CreateTask().ConstructAndDispatchWhenReady(ENamedThreads::AnyThread, MoveTemp(Lambda));
+	if (Pipeline.WorkerDone.IsSet())
+	{
+		Pipeline.Handoff = UE::Tasks::Launch(TEXT("WorldGen.Handoff"), MoveTemp(Handoff), UE::Tasks::Prerequisites(Pipeline.WorkerDone.GetValue()), UE::Tasks::ETaskPriority::Normal, UE::Tasks::EExtendedTaskPriority::GameThreadNormalPri);
+	}
+	else
+	{
+		Pipeline.Handoff = UE::Tasks::Launch(TEXT("WorldGen.Handoff"), MoveTemp(Handoff), UE::Tasks::Prerequisites(Pipeline.Normals, Pipeline.Plans), UE::Tasks::ETaskPriority::Normal, UE::Tasks::EExtendedTaskPriority::GameThreadNormalPri);
+	}
+
 	TilesInBuilding[BufferIndex] = Tile;		 // Store the tile for this buffer
 	PMCIndexForTile[BufferIndex] = PMCIndex; // Store the PMC index for this buffer
 	return true;
 }
 
+// 一个请求的所有阶段在同一个生成线程上串行执行，Heights 和 Points 不再并行，
+// 多个 slot 的 tile 之间由多个生成线程并行
+void AWorldGenerator::ExecuteWorkerStages(const FPCGRequest& Request)
+{
+	auto BufferIndex = Request.BufferIndex;
+	auto& Pipeline = Pipelines[BufferIndex];
+	const auto& Config = *Request.Config;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_WorldGen_Heights);
+		FScopedTileStageTimer Timer(Pipeline.Timings, ETileStage::Heights);
+		GenerateHeightsAsync(Config, BufferIndex, Request.Tile, Request.PositionOffset);
+	}
+	{
+		SCOPE_CYCLE_COUNTER(STAT_WorldGen_Normals);
+		FScopedTileStageTimer Timer(Pipeline.Timings, ETileStage::Normals);
+		GenerateNormalsAsync(Config, BufferIndex);
+	}
+	{
+		SCOPE_CYCLE_COUNTER(STAT_WorldGen_Points);
+		FScopedTileStageTimer Timer(Pipeline.Timings, ETileStage::Points);
+		GenerateRandomPointsAsync(Config, Request.Seed, BufferIndex, Request.Difficulty, Request.RandomTile, TaskDataBuffers[BufferIndex].SpawnSeeds);
+	}
+	{
+		SCOPE_CYCLE_COUNTER(STAT_WorldGen_SpawnPlans);
+		FScopedTileStageTimer Timer(Pipeline.Timings, ETileStage::Plans);
+		PlanSpawnersAsync(Config, Request.Seed, BufferIndex, Request.Tile, Request.RandomTile);
+	}
+	Pipeline.WorkerDone->Trigger();
+}
+
+void AWorldGenerator::OnWorkerStagesCompleted(int32 BufferIndex, uint32 Serial)
+{
+	check(IsInGameThread());
+	if (BufferStateGameThreadOnly[BufferIndex] != EBufferState::Busy || Pipelines[BufferIndex].Serial != Serial)
+	{
+		return; // EndPlay 之后才执行到这里，或者 warm start 已经提前处理了这个 tile
+	}
+	Pipelines[BufferIndex].NextGameThreadStage = 0;
+	BufferStateGameThreadOnly[BufferIndex] = EBufferState::Completed;
+}
+
+void AWorldGenerator::WaitForWorkerStages(int32 BufferIndex)
+{
+	auto& Pipeline = Pipelines[BufferIndex];
+	if (Pipeline.WorkerDone.IsSet())
+	{
+		Pipeline.WorkerDone->Wait();
+		return;
+	}
+	if (Pipeline.Normals.IsValid())
+	{
+		Pipeline.Normals.Wait();
+	}
+	if (Pipeline.Plans.IsValid())
+	{
+		Pipeline.Plans.Wait(); // Plans 依赖 Points
+	}
+}
+
+SIZE_T AWorldGenerator::GetTileStorageAllocatedSize() const
+{
+	SIZE_T Size = DeferredSpawns.GetAllocatedSize() + DeferredWaitList.GetAllocatedSize() + ReadyDeferredTiles.AllocatedCapacity() * sizeof(FInt32Point) + ExclusionIndex.GetAllocatedSize();
+	for (const auto& TaskData : TaskDataBuffers)
+	{
+		Size += TaskData.GetAllocatedSize();
+	}
+	for (const ABarrierSpawner* Spawner : BarrierSpawners)
+	{
+		if (Spawner)
+		{
+			Size += Spawner->GetTileStorageAllocatedSize();
+		}
+	}
+	return Size;
+}
+
+void AWorldGenerator::ReleaseBuffer(int32 BufferIndex)
+{
+	auto& Pipeline = Pipelines[BufferIndex];
+	for (int32 Stage = 0; Stage < (int32)ETileStage::Num; ++Stage)
+	{
+		StageTimeTotals.Seconds[Stage] += Pipeline.Timings.Seconds[Stage];
+	}
+	++CompletedTileCount;
+
+	// worker 阶段已经结束，slot 中的临时数据可以整体丢弃
+	auto& Arena = TaskDataBuffers[BufferIndex].Arena;
+	Arena.Reset();
+	auto HeapAllocations = Arena.ConsumeHeapAllocationCount();
+	// 容器只会在超过历史最大容量时扩容，总容量超过之前的最大值说明这个 tile 至少有一次堆分配
+	auto StorageSize = GetTileStorageAllocatedSize();
+	if (StorageSize > TileStorageHighWater)
+	{
+		++HeapAllocations;
+		TileStorageHighWater = StorageSize;
+	}
+	TileHeapAllocations += HeapAllocations;
+	INC_DWORD_STAT_BY(STAT_WorldGen_TileHeapAllocations, HeapAllocations);
+	SIZE_T ArenaCapacity = 0;
+	for (auto& TaskData : TaskDataBuffers)
+	{
+		ArenaCapacity += TaskData.Arena.GetCapacity();
+	}
+	SET_MEMORY_STAT(STAT_WorldGen_ArenaCapacity, ArenaCapacity);
+
+	Pipeline = FTilePipeline();
+	BufferStateGameThreadOnly[BufferIndex] = EBufferState::Idle; // Reset the buffer state
+	TilesInBuilding[BufferIndex] = FInt32Point(INT32_MAX, INT32_MAX); // Reset the tile in building
+}
+
 bool AWorldGenerator::ClearInactivePMCTiles()
 {
 	auto PMCIndex = GetInactivePMCIndex();
@@ -972,14 +1403,8 @@ bool AWorldGenerator::ClearInactivePMCTiles()
 			{
 				Spawner->RemoveTile(Tile);
 			}
-			RemoveSpecialLaserPos(Tile.X);
-
-			// 删除 CachedSpawnData 中对应 tile 的数据
-			auto RemovedNumber = CachedSpawnData.Remove(FIntVector(Tile.X, Tile.Y, PMCIndex));
-			if (RemovedNumber > 0)
-			{
-				UE_LOG(LogWorldGenerator, Warning, TEXT("Spawner %d, tile %s removed from CachedSpawnData before used!"), PMCIndex, *Tile.ToString());
-			}
+			RemoveTileExclusions(Tile);
+			DropDeferredSpawns(Tile);
 			ProceduralMeshComp[PMCIndex]->ClearMeshSection(MeshIndex);
 			TileMap[PMCIndex][MeshIndex] = FInt32Point(INT32_MAX, INT32_MAX); // Mark this tile as invalid
 		}
@@ -987,7 +1412,7 @@ bool AWorldGenerator::ClearInactivePMCTiles()
 	return bHasAnyWork;
 }
 
-void AWorldGenerator::GenerateNewTiles()
+void AWorldGenerator::CommitGeneratedTiles()
 {
 	// Get the player location
 	auto* Character = UGameplayStatics::GetPlayerCharacter(this, 0);
@@ -1010,20 +1435,237 @@ void AWorldGenerator::GenerateNewTiles()
 			// 如果有工作要做，直接返回
 			break;
 		}
-		for (auto It = CachedSpawnData.CreateIterator(); It; ++It)
-		{
-			auto Tile = FInt32Point(It.Key().X, It.Key().Y);
-			int32 BarrierIndex = It.Key().Z;
-			auto bSuccess = BarrierSpawners[BarrierIndex]->DeferSpawnBarriers(It.Value().Key, Tile, It.Value().Value, this);
-			if (bSuccess)
-			{
-				// UE_LOG(LogWorldGenerator, Warning, TEXT("Spawner %d, tile %s spawned barriers from CachedSpawnData!"), ReplacableIndex, *Tile.ToString());
-				It.RemoveCurrent();
-				break;
-			}
-		}
+		SpawnOneDeferredBarrier();
 	}
 	while (0);
+}
+
+bool AWorldGenerator::IsTileCommitted(FInt32Point Tile) const
+{
+	if (!IsValidTile(Tile))
+	{
+		return false;
+	}
+	for (int32 i = 0; i < MaxThreadCount; ++i)
+	{
+		if (TilesInBuilding[i] == Tile)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void AWorldGenerator::AddDeferredSpawn(FInt32Point Tile, int32 BarrierIndex, FSpawnSeedView Seeds, const FSpawnPlan& Plan)
+{
+	auto Dependency = BarrierSpawners[BarrierIndex]->GetDeferredSpawnDependency(Tile);
+	auto AbsoluteTile = GetAbsoluteTile(Tile);
+	auto& List = DeferredSpawns.FindOrAdd(Tile);
+	auto& Entry = List.AddPending();
+	Entry.BarrierIndex = BarrierIndex;
+	Entry.Dependency = GetAbsoluteTile(Dependency);
+	// 复制到条目已有的数组中，slot 中的规划结果会被下一个 tile 覆盖
+	Entry.Plan.CopyFrom(Plan);
+	Entry.Seeds.CopyFrom(Seeds);
+
+	// 依赖的 tile 已经 commit 的话直接进入就绪队列，否则等它 commit 时唤醒
+	if (IsTileCommitted(Dependency))
+	{
+		EnqueueReadyDeferredTile(AbsoluteTile, List);
+	}
+	else
+	{
+		DeferredWaitList.FindOrAdd(Dependency).AddUnique(AbsoluteTile);
+	}
+}
+
+void AWorldGenerator::DropDeferredSpawns(FInt32Point Tile)
+{
+	auto* List = DeferredSpawns.Find(Tile);
+	if (!List)
+	{
+		return;
+	}
+	UE_LOG(LogWorldGenerator, Warning, TEXT("Tile %s removed with deferred spawns not used!"), *Tile.ToString());
+
+	// 从依赖 tile 的等待队列中移除，否则依赖一直不 commit 时这些条目会留在容器中
+	auto AbsoluteTile = GetAbsoluteTile(Tile);
+	for (const auto& Entry : List->Entries)
+	{
+		if (!Entry.bPending)
+		{
+			continue;
+		}
+		auto Dependency = GetRelativeTile(Entry.Dependency);
+		auto* Waiters = DeferredWaitList.Find(Dependency);
+		if (Waiters && Waiters->Remove(AbsoluteTile) > 0 && Waiters->IsEmpty())
+		{
+			DeferredWaitList.Remove(Dependency);
+		}
+	}
+	DeferredSpawns.Remove(Tile);
+	// 就绪队列中的条目在使用时跳过
+}
+
+void AWorldGenerator::EnqueueReadyDeferredTile(FInt32Point Tile, FDeferredSpawnList& List)
+{
+	if (!List.bQueued)
+	{
+		List.bQueued = true;
+		ReadyDeferredTiles.Enqueue(Tile);
+	}
+}
+
+void AWorldGenerator::OnTileCommitted(FInt32Point Tile)
+{
+	auto* Waiters = DeferredWaitList.Find(Tile);
+	if (!Waiters)
+	{
+		return;
+	}
+	for (auto Waiter : *Waiters)
+	{
+		if (auto* List = DeferredSpawns.Find(GetRelativeTile(Waiter)))
+		{
+			EnqueueReadyDeferredTile(Waiter, *List);
+		}
+	}
+	DeferredWaitList.Remove(Tile);
+}
+
+bool AWorldGenerator::SpawnOneDeferredBarrier()
+{
+	while (!ReadyDeferredTiles.IsEmpty())
+	{
+		auto AbsoluteTile = ReadyDeferredTiles.Peek();
+		auto Tile = GetRelativeTile(AbsoluteTile);
+		auto* List = DeferredSpawns.Find(Tile);
+		if (!List || !List->bQueued)
+		{
+			// tile 已经被移除，或者是移除之后重新生成的 tile，它会在依赖 commit 时重新入队
+			ReadyDeferredTiles.Pop();
+			continue;
+		}
+
+		for (auto& Entry : List->Entries)
+		{
+			if (!Entry.bPending)
+			{
+				continue;
+			}
+			auto Dependency = GetRelativeTile(Entry.Dependency);
+			if (!IsTileCommitted(Dependency))
+			{
+				// 依赖的 tile 还没 commit（或者 commit 之后又被移除了），等它 commit 时再唤醒
+				DeferredWaitList.FindOrAdd(Dependency).AddUnique(AbsoluteTile);
+				continue;
+			}
+			FInt32Point MissingTile;
+			if (!BarrierSpawners[Entry.BarrierIndex]->DeferSpawnBarriers(Entry.Seeds.View(), Tile, Entry.Plan, this, MissingTile))
+			{
+				// spawner 还需要其它的 tile，改为等待它 commit，移除时也从它的等待队列中删除
+				ensure(!IsTileCommitted(MissingTile));
+				Entry.Dependency = GetAbsoluteTile(MissingTile);
+				DeferredWaitList.FindOrAdd(MissingTile).AddUnique(AbsoluteTile);
+				continue;
+			}
+			List->MarkDone(Entry);
+			if (List->NumPending == 0)
+			{
+				DeferredSpawns.Remove(Tile);
+				ReadyDeferredTiles.Pop();
+			}
+			// 还有条目的话留在队首，下一次继续
+			return true;
+		}
+
+		// 这个 tile 剩下的条目都在等待其他 tile
+		List->bQueued = false;
+		ReadyDeferredTiles.Pop();
+	}
+	return false;
+}
+
+void AWorldGenerator::WarmStart()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WorldGen_WarmStart);
+	auto StartTime = FPlatformTime::Seconds();
+
+	// 和 DispatchNewTiles 中的窗口保持一致
+	TArray<FInt32Point> StartTiles;
+	if (bOneLineMode)
+	{
+		for (int32 X = PlayerStartTile.X - 1; X <= PlayerStartTile.X + 3; ++X)
+		{
+			StartTiles.Add(FInt32Point(X, 0));
+		}
+	}
+	else
+	{
+		for (int32 Y = PlayerStartTile.Y - 1; Y <= PlayerStartTile.Y + 1; ++Y)
+		{
+			for (int32 X = PlayerStartTile.X - 1; X <= PlayerStartTile.X + 1; ++X)
+			{
+				StartTiles.Add(FInt32Point(X, Y));
+			}
+		}
+	}
+	StartTiles.RemoveAll([this](FInt32Point Tile) { return !IsNeccessrayTile(Tile); });
+
+	bWarmStarting = true;
+	// 每一轮最多派发 MaxThreadCount 个 tile，轮数有上限，防止某个 tile 始终无法生成时死循环
+	for (int32 Round = 0; Round <= StartTiles.Num(); ++Round)
+	{
+		auto bAllValid = true;
+		for (auto Tile : StartTiles)
+		{
+			if (!IsValidTile(Tile))
+			{
+				bAllValid = false;
+				if (!GenerateOneTile(Tile))
+				{
+					break;
+				}
+			}
+		}
+		if (bAllValid)
+		{
+			break;
+		}
+
+		for (int32 i = 0; i < MaxThreadCount; ++i)
+		{
+			if (BufferStateGameThreadOnly[i] == EBufferState::Busy)
+			{
+				WaitForWorkerStages(i);
+				OnWorkerStagesCompleted(i, Pipelines[i].Serial);
+			}
+		}
+		// 不限制实例数和时间，一次性提交所有已完成的 tile（地形网格会用完单次的预算，因此重复执行）
+		FSpawnBudget Unlimited;
+		while (RunGameThreadStages(Unlimited))
+		{
+			Unlimited = FSpawnBudget();
+		}
+	}
+	bWarmStarting = false;
+
+	// 金币等延迟 spawn 的障碍物依赖相邻的 tile，此时起始区域已经完整
+	while (SpawnOneDeferredBarrier())
+	{
+	}
+
+	bWorldReady = true;
+	UE_LOG(LogWorldGenerator, Log, TEXT("Warm start generated %d tiles in %.2f ms"), StartTiles.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	OnWorldReady.Broadcast();
+}
+
+void AWorldGenerator::DispatchNewTiles()
+{
+	if (!UGameplayStatics::GetPlayerCharacter(this, 0))
+	{
+		return;
+	}
 
 	// Generate new tiles around the player
 	auto PlayerTile = GetPlayerTile();
@@ -1071,6 +1713,7 @@ bool AWorldGenerator::ConditionalMoveWorldOrigin()
 	if (Character && Character->GetActorLocation().X > MoveOriginDistance)
 	{
 		WorldOriginOffset.X += MoveOriginDistance;
+		RebuildGenConfig();
 
 		// 偏移地形
 		int32 PMCIndex;
@@ -1101,15 +1744,10 @@ bool AWorldGenerator::ConditionalMoveWorldOrigin()
 		// evil pos 更新
 		EvilPos -= MoveOriginDistance;
 
-		// 更新 Cached Spawned Data 中的 tile 坐标
-		TMap<FIntVector, TPair<TArray<RandomPoint>, FVector2D>> NewCachedData;
-		NewCachedData.Reserve(CachedSpawnData.Num());
-		for (auto& It : CachedSpawnData)
-		{
-			auto NewKey = FIntVector(It.Key.X - MoveOriginXTile, It.Key.Y, It.Key.Z);
-			NewCachedData.Add(NewKey, MoveTemp(It.Value));
-		}
-		CachedSpawnData = MoveTemp(NewCachedData);
+		// 延迟 spawn 和禁止区域中存放的都是绝对 tile 编号，只需要移动容器的原点
+		DeferredSpawns.MoveWorldOrigin(MoveOriginXTile);
+		DeferredWaitList.MoveWorldOrigin(MoveOriginXTile);
+		ExclusionIndex.MoveWorldOrigin(MoveOriginXTile);
 
 		// 通知 BarrierSpawner 更新它们的 tile 和障碍物坐标
 		for (ABarrierSpawner* Spawner : BarrierSpawners)
@@ -1286,140 +1924,240 @@ FVector2D AWorldGenerator::ClampToWorld(FVector2D Pos, double Radius) const
 // 	Point.Transform.SetTranslation(WorldPos);
 // }
 
-void AWorldGenerator::GenerateOneTileAsync(int64 Seed, int32 BufferIndex, int32 Difficulty, FInt32Point Tile, FVector2D PositionOffset)
+// 和 UKismetProceduralMeshLibrary::CalculateTangentsForMesh 的算法一致：面法线和 UV 方向的切线按顶点累加后归一化
+// 地形网格的顶点不会重合，不需要它查找重合顶点的 O(n^2) 过程，也没有它每次调用的 TArray/TMultiMap 分配，累加使用 slot 中的 Sums
+static void CalculateGridTangents(const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const TArray<FVector2D>& UVs, TArray<FVector3f>& Sums, TArray<FVector>& OutNormals, TArray<FProcMeshTangent>& OutTangents)
+{
+	auto NumVerts = Vertices.Num();
+	Sums.SetNumUninitialized(NumVerts * 3, EAllowShrinking::No);
+	FMemory::Memzero(Sums.GetData(), Sums.Num() * sizeof(FVector3f));
+	auto* SumX = Sums.GetData();
+	auto* SumY = SumX + NumVerts;
+	auto* SumZ = SumY + NumVerts;
+
+	for (int32 Tri = 0; Tri + 2 < Triangles.Num(); Tri += 3)
+	{
+		int32 Corners[3] = { Triangles[Tri], Triangles[Tri + 1], Triangles[Tri + 2] };
+		FVector3f P0(Vertices[Corners[0]]);
+		FVector3f P1(Vertices[Corners[1]]);
+		FVector3f P2(Vertices[Corners[2]]);
+		auto TangentZ = ((P1 - P2) ^ (P0 - P2)).GetSafeNormal();
+
+		// 等价于 ParameterToTexture.Inverse() * ParameterToLocal 的前两行
+		auto Edge1 = P1 - P0;
+		auto Edge2 = P2 - P0;
+		FVector2f UV1(UVs[Corners[1]] - UVs[Corners[0]]);
+		FVector2f UV2(UVs[Corners[2]] - UVs[Corners[0]]);
+		auto Det = UV1.X * UV2.Y - UV1.Y * UV2.X;
+		auto TangentX = FVector3f::ZeroVector;
+		auto TangentY = FVector3f::ZeroVector;
+		if (Det != 0.0f)
+		{
+			TangentX = ((Edge1 * UV2.Y - Edge2 * UV1.Y) / Det).GetSafeNormal();
+			TangentY = ((Edge2 * UV1.X - Edge1 * UV2.X) / Det).GetSafeNormal();
+		}
+
+		for (int32 Corner : Corners)
+		{
+			SumX[Corner] += TangentX;
+			SumY[Corner] += TangentY;
+			SumZ[Corner] += TangentZ;
+		}
+	}
+
+	OutNormals.SetNumUninitialized(NumVerts, EAllowShrinking::No);
+	OutTangents.SetNumUninitialized(NumVerts, EAllowShrinking::No);
+	for (int32 Index = 0; Index < NumVerts; ++Index)
+	{
+		auto TangentX = SumX[Index].GetSafeNormal();
+		auto TangentY = SumY[Index].GetSafeNormal();
+		auto TangentZ = SumZ[Index].GetSafeNormal();
+		// Gram-Schmidt 正交化
+		TangentX = (TangentX - TangentZ * (TangentZ | TangentX)).GetSafeNormal();
+		OutNormals[Index] = FVector(TangentZ);
+		OutTangents[Index] = FProcMeshTangent(FVector(TangentX), ((TangentZ ^ TangentX) | TangentY) < 0.0f);
+	}
+}
+
+void AWorldGenerator::GenerateHeightsAsync(const FWorldGenConfig& Config, int32 BufferIndex, FInt32Point Tile, FVector2D PositionOffset)
 {
-	// 在这里执行异步生成逻辑
 	auto& TaskData = TaskDataBuffers[BufferIndex];
 	auto& VerticesBuffer = TaskData.VerticesBuffer;
 	auto& UV0Buffer = TaskData.UV0Buffer;
-	auto& NormalsBuffer = TaskData.NormalsBuffer;
-	auto& TangentsBuffer = TaskData.TangentsBuffer;
 
-	double XOffset = (double)Tile.X * CellSize * XCellNumber;
-	double YOffset = (double)Tile.Y * CellSize * YCellNumber;
+	auto CellX = Config.XCellNumber;
+	auto CellY = Config.YCellNumber;
+	double XOffset = Tile.X * Config.GetTileSizeX();
+	double YOffset = Tile.Y * Config.GetTileSizeY();
 
-	for (int32 Y = 0; Y <= YCellNumber; ++Y)
+	for (int32 Y = 0; Y <= CellY; ++Y)
 	{
-		for (int32 X = 0; X <= XCellNumber; ++X)
+		for (int32 X = 0; X <= CellX; ++X)
 		{
-			FVector VertexPosition(double(X) * CellSize + XOffset, double(Y) * CellSize + YOffset, 0.0);
-			VertexPosition.Z = GetHeightFromPerlinAnyThread(FVector2D(VertexPosition.X, VertexPosition.Y), FInt32Point(Tile.X * XCellNumber + X, Tile.Y * YCellNumber + Y));
-			VerticesBuffer[Y * (XCellNumber + 1) + X] = FVector(VertexPosition.X - PositionOffset.X, VertexPosition.Y - PositionOffset.Y, VertexPosition.Z);
-			UV0Buffer[Y * (XCellNumber + 1) + X] = GetUVFromPosAnyThread(VertexPosition);
+			FVector VertexPosition(double(X) * Config.CellSize + XOffset, double(Y) * Config.CellSize + YOffset, 0.0);
+			VertexPosition.Z = Config.GetVertexHeight(Tile, X, Y);
+			VerticesBuffer[Y * (CellX + 1) + X] = FVector(VertexPosition.X - PositionOffset.X, VertexPosition.Y - PositionOffset.Y, VertexPosition.Z);
+			UV0Buffer[Y * (CellX + 1) + X] = Config.GetUVFromPos(VertexPosition);
 		}
 	}
+}
 
-	UKismetProceduralMeshLibrary::CalculateTangentsForMesh(VerticesBuffer, TrianglesBuffer, UV0Buffer, NormalsBuffer, TangentsBuffer);
-	GenerateRandomPointsAsync(Seed, BufferIndex, Difficulty, Tile, TaskDataBuffers[BufferIndex].RandomPoints);
+FNormalStageOutput AWorldGenerator::GenerateNormalsAsync(const FWorldGenConfig& Config, int32 BufferIndex)
+{
+	auto& TaskData = TaskDataBuffers[BufferIndex];
+	auto& NormalsBuffer = TaskData.NormalsBuffer;
+	auto& TangentsBuffer = TaskData.TangentsBuffer;
 
-	// Game 线程的回调
-	AsyncTask(ENamedThreads::GameThread, TUniqueFunction<void()>([this, BufferIndex]() {
-		BufferStateGameThreadOnly[BufferIndex] = EBufferState::Completed;
-	}));
+	CalculateGridTangents(TaskData.VerticesBuffer, *Config.Triangles, TaskData.UV0Buffer, TaskData.TangentSums, NormalsBuffer, TangentsBuffer);
+	return FNormalStageOutput{ NormalsBuffer, TangentsBuffer };
+}
+
+void AWorldGenerator::GenerateRandomPointsAsync(const FWorldGenConfig& Config, int64 Seed, int32 BufferIndex, int32 Difficulty, FInt32Point Tile, FSpawnSeedBuffer& SpawnSeeds)
+{
+	// GenerateUniformRandomPointsAsync(Config, Seed, Tile, BufferIndex, Difficulty, SpawnSeeds);
+	GeneratePoissonRandomPointsAsync(Config, Seed, Tile, BufferIndex, Difficulty, SpawnSeeds);
+	// UE_LOG(LogWorldGenerator, Warning, TEXT("Generated %d random points for tile %s in buffer %d"), SpawnSeeds.Num(), *Tile.ToString(), BufferIndex);
 }
 
-void AWorldGenerator::GenerateRandomPointsAsync(int64 Seed, int32 BufferIndex, int32 Difficulty, FInt32Point Tile, TArray<RandomPoint>& RandomPoints)
+void AWorldGenerator::PlanSpawnersAsync(const FWorldGenConfig& Config, int64 Seed, int32 BufferIndex, FInt32Point Tile, FInt32Point RandomTile)
 {
-	TaskDataBuffers[BufferIndex].RandomEngine.seed(Seed);
+	auto& TaskData = TaskDataBuffers[BufferIndex];
+	// 采样点所在的 tile 直接读取刚生成的高度图和法线，相邻的 tile 由快照计算
+	FTerrainHeightSampler Sampler(Config, Tile, TaskData.VerticesBuffer, TaskData.NormalsBuffer);
 
-	// GenerateUniformRandomPointsAsync(BufferIndex, RandomPoints);
-	GeneratePoissonRandomPointsAsync(BufferIndex, Difficulty, RandomPoints);
-	// UE_LOG(LogWorldGenerator, Warning, TEXT("Generated %d random points for tile %s in buffer %d"), RandomPoints.Num(), *Tile.ToString(), BufferIndex);
+	int32 StartIdx = 0;
+	for (int32 Idx = 0; Idx < Config.Spawners.Num(); ++Idx)
+	{
+		auto& Plan = TaskData.SpawnPlans[Idx];
+		Plan.Reset();
+		auto BarCount = TaskData.BarriersCount[Idx];
+		const auto& SpawnerConfig = Config.Spawners[Idx];
+		if (SpawnerConfig.CoinTrajectory.IsSet() && BarCount > 0)
+		{
+			// 最后一个点用于地面上的金币轨迹
+			auto GroundSeeds = TaskData.SpawnSeeds.Slice(StartIdx + BarCount - 1, 1);
+			CoinTrajectory::PlanGroundTrace(Config, SpawnerConfig.CoinTrajectory.GetValue(), Sampler, Tile, GroundSeeds.GetUV(0).Y, Plan);
+		}
+		if (SpawnerConfig.bPlanTransforms && BarCount > 0)
+		{
+			Plan.OriginOffsetX = Config.WorldOriginOffset.X;
+			SpawnTransform::FromSeeds(Config, SpawnerConfig.Transform, Sampler, Tile, TaskData.SpawnSeeds.Slice(StartIdx, BarCount), Plan.PointTransforms);
+		}
+		if (SpawnerConfig.ClusterLayout.IsSet() && SpawnerConfig.ClusterLayout->MeshNumber > 0)
+		{
+			Plan.OriginOffsetX = Config.WorldOriginOffset.X;
+			Plan.InstanceStarts.Reserve(BarCount + 1);
+			auto Seeds = TaskData.SpawnSeeds.Slice(StartIdx, BarCount);
+			for (int32 PointIndex = 0; PointIndex < BarCount; ++PointIndex)
+			{
+				// 每个簇有自己的随机流，跨帧继续或者先后顺序变化都不影响结果
+				FTileRandomStream Random(Seed, RandomTile, ETileRandomStream::Cluster, (uint32(Idx) << 16) | uint32(PointIndex));
+				Plan.InstanceStarts.Add(Plan.Instances.Num());
+				SpawnTransform::PlanCluster(Config, SpawnerConfig.Transform, SpawnerConfig.ClusterLayout.GetValue(), Sampler, Tile, Seeds[PointIndex], Random, Plan.Instances);
+			}
+			Plan.InstanceStarts.Add(Plan.Instances.Num());
+		}
+		StartIdx += BarCount;
+	}
 }
 
-void AWorldGenerator::GenerateUniformRandomPointsAsync(int32 BufferIndex, int32 Difficulty, TArray<RandomPoint>& RandomPoints)
+void AWorldGenerator::GenerateUniformRandomPointsAsync(const FWorldGenConfig& Config, int64 Seed, FInt32Point Tile, int32 BufferIndex, int32 Difficulty, FSpawnSeedBuffer& SpawnSeeds)
 {
-	std::uniform_real_distribution<double> PointGenerator(0.0, 1.0);
+	FTileRandomStream CountRandom(Seed, Tile, ETileRandomStream::BarrierCount);
+	FTileRandomStream PointRandom(Seed, Tile, ETileRandomStream::UngroupedPoints);
 
 	int32 Idx = 0;
 	int32 TotalBarrierCount = 0;
-	for (ABarrierSpawner* Spawner : BarrierSpawners)
+	for (const auto& Spawner : Config.Spawners)
 	{
-		auto BarCount = Spawner->GetBarrierCountAnyThread(PointGenerator(TaskDataBuffers[BufferIndex].RandomEngine), Difficulty);
+		auto BarCount = Spawner.GetBarrierCount(CountRandom.UnitAt(Idx), Difficulty);
 		TaskDataBuffers[BufferIndex].BarriersCount[Idx] = BarCount; // 记录每个 Spawner 的障碍物数量
 		TotalBarrierCount += BarCount;
 		++Idx;
 	}
-	RandomPoints.SetNumUninitialized(TotalBarrierCount, EAllowShrinking::No);
+	SpawnSeeds.SetNumUninitialized(TotalBarrierCount);
 
 	for (int32 i = 0; i < TotalBarrierCount; ++i)
 	{
-		auto& Point = RandomPoints[i];
 		auto UVPos = FVector2D::ZeroVector;
-		UVPos.X = PointGenerator(TaskDataBuffers[BufferIndex].RandomEngine);
-		UVPos.Y = PointGenerator(TaskDataBuffers[BufferIndex].RandomEngine);
-		Point.UVPos = UVPos;
-		auto Rotation = FRotator::ZeroRotator;
-		Rotation.Yaw = PointGenerator(TaskDataBuffers[BufferIndex].RandomEngine);
-		Rotation.Pitch = PointGenerator(TaskDataBuffers[BufferIndex].RandomEngine);
-		Rotation.Roll = PointGenerator(TaskDataBuffers[BufferIndex].RandomEngine);
-
-		Point.Rotation = Rotation;
-		Point.Scale = FVector(1.0, 1.0, 1.0); // 设置默认缩放
+		UVPos.X = PointRandom.NextUnit();
+		UVPos.Y = PointRandom.NextUnit();
+		auto Yaw = PointRandom.NextUnit();
+		auto Pitch = PointRandom.NextUnit();
+		auto Roll = PointRandom.NextUnit();
+		SpawnSeeds.Set(i, UVPos, Yaw, Pitch, Roll);
 	}
 }
 
-void AWorldGenerator::GeneratePoissonRandomPointsAsync(int32 BufferIndex, int32 Difficulty, TArray<RandomPoint>& RandomPoints)
+void AWorldGenerator::GeneratePoissonRandomPointsAsync(const FWorldGenConfig& Config, int64 Seed, FInt32Point Tile, int32 BufferIndex, int32 Difficulty, FSpawnSeedBuffer& SpawnSeeds)
 {
-	RandomPoints.SetNumUninitialized(0, EAllowShrinking::No);
+	SpawnSeeds.SetNumUninitialized(0);
 
-	auto XSize = CellSize * XCellNumber;
-	auto YSize = CellSize * YCellNumber;
+	auto XSize = Config.GetTileSizeX();
+	auto YSize = Config.GetTileSizeY();
+	const auto& Spawners = Config.Spawners;
+	const auto& Libraries = *Config.PointSetLibraries;
 
-	auto& RandomEngine = TaskDataBuffers[BufferIndex].RandomEngine;
-	std::uniform_real_distribution<double> UniformGenerator(0.0, 1.0);
-	TArray<FVector2D> OutPoints;
-	TInlineComponentArray<int32, 10> EachSpawnerCounts;
-	EachSpawnerCounts.SetNumUninitialized(BarrierSpawners.Num(), EAllowShrinking::No);
+	// 每个 spawner 的数量、每个分组的采样和种子都有独立的随机流，互不影响，也可以并行计算
+	FTileRandomStream CountRandom(Seed, Tile, ETileRandomStream::BarrierCount);
+	auto& Arena = TaskDataBuffers[BufferIndex].Arena;
+	auto& PoissonScratch = TaskDataBuffers[BufferIndex].PoissonScratch;
+	auto& OutPoints = PoissonScratch.Points;
+	auto EachSpawnerCounts = Arena.AllocateUninitialized<int32>(Spawners.Num());
 
 	auto StartIndex = 0;
-	for (; StartIndex < BarrierSpawners.Num() && BarrierSpawners[StartIndex]->BarrierGroup < 0; ++StartIndex)
+	for (; StartIndex < Spawners.Num() && Spawners[StartIndex].BarrierGroup < 0; ++StartIndex)
 	{
-		auto BarCount = BarrierSpawners[StartIndex]->GetBarrierCountAnyThread(UniformGenerator(RandomEngine), Difficulty);
+		auto BarCount = Spawners[StartIndex].GetBarrierCount(CountRandom.UnitAt(StartIndex), Difficulty);
 		TaskDataBuffers[BufferIndex].BarriersCount[StartIndex] = BarCount;
-		auto OldPosCnt = RandomPoints.Num();
-		RandomPoints.SetNum(OldPosCnt + BarCount, EAllowShrinking::No);
+		FTileRandomStream PointRandom(Seed, Tile, ETileRandomStream::UngroupedPoints, StartIndex);
+		auto OldPosCnt = SpawnSeeds.Num();
+		SpawnSeeds.SetNumUninitialized(OldPosCnt + BarCount);
 		for (int32 i = OldPosCnt; i < OldPosCnt + BarCount; ++i)
 		{
-			auto& Point = RandomPoints[i];
 			auto UVPos = FVector2D::ZeroVector;
-			UVPos.X = UniformGenerator(RandomEngine);
-			UVPos.Y = UniformGenerator(RandomEngine);
-			Point.UVPos = UVPos;
-			auto Rotation = FRotator::ZeroRotator;
-			Rotation.Yaw = UniformGenerator(RandomEngine);
-			Rotation.Pitch = UniformGenerator(RandomEngine);
-			Rotation.Roll = UniformGenerator(RandomEngine);
-
-			Point.Rotation = Rotation;
-			Point.Scale = FVector(1.0, 1.0, 1.0); // 设置默认缩放
+			UVPos.X = PointRandom.NextUnit();
+			UVPos.Y = PointRandom.NextUnit();
+			auto Yaw = PointRandom.NextUnit();
+			auto Pitch = PointRandom.NextUnit();
+			auto Roll = PointRandom.NextUnit();
+			SpawnSeeds.Set(i, UVPos, Yaw, Pitch, Roll);
 		}
 	}
 
-	while (StartIndex < BarrierSpawners.Num() && BarrierSpawners[StartIndex]->BarrierGroup >= 0)
+	while (StartIndex < Spawners.Num() && Spawners[StartIndex].BarrierGroup >= 0)
 	{
-		int32 GroupIndex = BarrierSpawners[StartIndex]->BarrierGroup;
-		ensure(GroupIndex < GroupDistanceFunc.Num()); // 确保分组索引在范围内
+		int32 GroupIndex = Spawners[StartIndex].BarrierGroup;
+		ensure(GroupIndex < Config.GroupDistanceFunc.Num()); // 确保分组索引在范围内
 
 		// 计算每组中 Spawner 希望的障碍物数量
 		int32 ExpectedBarrierCount = 0;
 		int32 EndIndex = StartIndex;
 		double PoissonDistance = 0;
-		for (; EndIndex < BarrierSpawners.Num() && BarrierSpawners[EndIndex]->BarrierGroup == GroupIndex; ++EndIndex)
+		for (; EndIndex < Spawners.Num() && Spawners[EndIndex].BarrierGroup == GroupIndex; ++EndIndex)
 		{
-			int32 BarCount = BarrierSpawners[EndIndex]->GetBarrierCountAnyThread(UniformGenerator(RandomEngine), Difficulty);
-			PoissonDistance = FMath::Max(PoissonDistance, BarrierSpawners[EndIndex]->PoissonDistance);
+			int32 BarCount = Spawners[EndIndex].GetBarrierCount(CountRandom.UnitAt(EndIndex), Difficulty);
+			PoissonDistance = FMath::Max(PoissonDistance, Spawners[EndIndex].PoissonDistance);
 			EachSpawnerCounts[EndIndex] = BarCount;
 			ExpectedBarrierCount += BarCount;
 		}
 		ensure(PoissonDistance > 0.0);
 
-		OutPoints.SetNum(0, EAllowShrinking::No);
-		auto DistFunc = GetDistanceFunc(GroupDistanceFunc[GroupIndex]);
-		auto SampleNumber = PoissonSampling(XSize, YSize, PoissonDistance, SampleCountBeforeReject, RandomEngine, DistFunc, OutPoints);
+		PoissonScratch.Prepare(Arena, FPoissonScratch::GetMaxPointCount(XSize, YSize, PoissonDistance));
+		FTileRandomStream SampleRandom(Seed, Tile, ETileRandomStream::GroupSampling, GroupIndex);
+		int32 SampleNumber = 0;
+		if (Libraries.IsValidIndex(GroupIndex) && Libraries[GroupIndex].Sets.Num() > 0)
+		{
+			ensure(Libraries[GroupIndex].MinDistance == PoissonDistance);
+			SampleNumber = SamplePrecomputedPoints(Libraries[GroupIndex], XSize, YSize, SampleRandom, OutPoints);
+		}
+		else
+		{
+			SampleNumber = SampleGroupPoints(Config.GroupDistanceFunc[GroupIndex], XSize, YSize, PoissonDistance, ExpectedBarrierCount, Config.SampleCountBeforeReject, SampleRandom, PoissonScratch);
+		}
 		ensure(SampleNumber == OutPoints.Num()); // 确保采样点数量与返回值一致
 
-		if (bCheckPoissonSampling)
+		if (Config.bCheckPoissonSampling)
 		{
 			for (int32 i = 0; i < OutPoints.Num(); ++i)
 			{
@@ -1460,32 +2198,29 @@ void AWorldGenerator::GeneratePoissonRandomPointsAsync(int32 BufferIndex, int32
 		// 		GroupIndex, RealTotalBarrierCount);
 
 		// TArray 返回的迭代器与 std 需要的迭代器不匹配
-		std::shuffle(OutPoints.GetData(), OutPoints.GetData() + SampleNumber, RandomEngine);
-		auto OldPosCnt = RandomPoints.Num();
-		RandomPoints.SetNum(OldPosCnt + RealTotalBarrierCount, EAllowShrinking::No);
+		std::shuffle(OutPoints.GetData(), OutPoints.GetData() + SampleNumber, SampleRandom);
+		FTileRandomStream SeedRandom(Seed, Tile, ETileRandomStream::GroupSeeds, GroupIndex);
+		auto OldPosCnt = SpawnSeeds.Num();
+		SpawnSeeds.SetNumUninitialized(OldPosCnt + RealTotalBarrierCount);
 		for (int32 i = OldPosCnt; i < OldPosCnt + RealTotalBarrierCount; ++i)
 		{
 			OutPoints[i - OldPosCnt].X /= XSize;
 			OutPoints[i - OldPosCnt].Y /= YSize;
 
-			RandomPoints[i].UVPos = OutPoints[i - OldPosCnt];
-			auto Rotation = FRotator::ZeroRotator;
-			Rotation.Yaw = UniformGenerator(RandomEngine);
-			Rotation.Pitch = UniformGenerator(RandomEngine);
-			Rotation.Roll = UniformGenerator(RandomEngine);
-
-			RandomPoints[i].Rotation = Rotation;
-			RandomPoints[i].Scale = FVector(1.0, 1.0, 1.0); // 设置默认缩放
+			auto Yaw = SeedRandom.NextUnit();
+			auto Pitch = SeedRandom.NextUnit();
+			auto Roll = SeedRandom.NextUnit();
+			SpawnSeeds.Set(i, OutPoints[i - OldPosCnt], Yaw, Pitch, Roll);
 		}
 
-		if (bCheckPoissonSampling)
+		if (Config.bCheckPoissonSampling)
 		{
 			for (int32 i = OldPosCnt; i < OldPosCnt + RealTotalBarrierCount; ++i)
 			{
 				for (int32 j = i + 1; j < OldPosCnt + RealTotalBarrierCount; ++j)
 				{
-					auto Pos1 = FVector2D(RandomPoints[i].UVPos.X * XSize, RandomPoints[i].UVPos.Y * YSize);
-					auto Pos2 = FVector2D(RandomPoints[j].UVPos.X * XSize, RandomPoints[j].UVPos.Y * YSize);
+					auto Pos1 = FVector2D(SpawnSeeds.UV[i].X * XSize, SpawnSeeds.UV[i].Y * YSize);
+					auto Pos2 = FVector2D(SpawnSeeds.UV[j].X * XSize, SpawnSeeds.UV[j].Y * YSize);
 					// 检查采样点
 					auto Dist = FVector2D::Distance(Pos1, Pos2);
 					if (Dist < PoissonDistance)
@@ -1500,42 +2235,257 @@ void AWorldGenerator::GeneratePoissonRandomPointsAsync(int32 BufferIndex, int32
 		StartIndex = EndIndex; // 更新 StartIndex 到下一个分组的起始位置
 	}
 
-	ensure(StartIndex == BarrierSpawners.Num()); // 确保所有 Spawner 都被处理
+	ensure(StartIndex == Spawners.Num()); // 确保所有 Spawner 都被处理
+}
+
+void AWorldGenerator::BuildPointSetLibraries()
+{
+	auto Libraries = MakeShared<TArray<FPointSetLibrary>>();
+	PointSetLibraries = Libraries;
+	if (!bUsePrecomputedPointSets)
+	{
+		return;
+	}
+
+	auto XSize = CellSize * XCellNumber;
+	auto YSize = CellSize * YCellNumber;
+	// 点集只依赖全局种子，保证同一个种子生成的世界完全一致
+	FTileArena Arena;
+	FPoissonScratch Scratch;
+
+	// BarrierSpawners 已经按组号排序
+	for (ABarrierSpawner* Spawner : BarrierSpawners)
+	{
+		auto GroupIndex = Spawner->BarrierGroup;
+		if (GroupIndex < 0)
+		{
+			continue;
+		}
+		if (Libraries->Num() <= GroupIndex)
+		{
+			Libraries->SetNum(GroupIndex + 1);
+		}
+		auto& Library = (*Libraries)[GroupIndex];
+		Library.MinDistance = FMath::Max(Library.MinDistance, Spawner->PoissonDistance);
+	}
+
+	auto TotalPoints = 0;
+	for (int32 GroupIndex = 0; GroupIndex < Libraries->Num(); ++GroupIndex)
+	{
+		auto& Library = (*Libraries)[GroupIndex];
+		// 单轴分组的一维采样本身就是 O(n) 的，不需要预计算
+		auto Func = GroupDistanceFunc.IsValidIndex(GroupIndex) ? GroupDistanceFunc[GroupIndex] : EDistanceFunc::Euclidean;
+		if (Func != EDistanceFunc::Euclidean || Library.MinDistance <= 0.0)
+		{
+			continue;
+		}
+		Library.Sets.SetNum(PrecomputedPointSetCount);
+		for (int32 SetIndex = 0; SetIndex < Library.Sets.Num(); ++SetIndex)
+		{
+			auto& Set = Library.Sets[SetIndex];
+			FTileRandomStream Random(uint32(BarrierRandom), FInt32Point::ZeroValue, ETileRandomStream::PointSetLibrary, GroupIndex * PrecomputedPointSetCount + SetIndex);
+			Arena.Reset();
+			Scratch.Prepare(Arena, FPoissonScratch::GetMaxPointCount(XSize, YSize, Library.MinDistance));
+			auto Count = PeriodicPoissonSampling(XSize, YSize, Library.MinDistance, SampleCountBeforeReject, Random, Scratch);
+			Set.SetNumUninitialized(Count);
+			for (int32 i = 0; i < Count; ++i)
+			{
+				Set[i] = FVector2f(Scratch.Points[i].X / XSize, Scratch.Points[i].Y / YSize);
+			}
+			TotalPoints += Count;
+		}
+	}
+	UE_LOG(LogWorldGenerator, Log, TEXT("Precomputed %d Poisson point sets per group, %d points in total"), PrecomputedPointSetCount, TotalPoints);
+}
+
+int32 AWorldGenerator::SamplePrecomputedPoints(const FPointSetLibrary& Library, double XSize, double YSize, FTileRandomStream& Random, TArenaArray<FVector2D>& OutPoints)
+{
+	auto SetIndex = FMath::Clamp(FMath::FloorToInt32(Random.NextUnit() * Library.Sets.Num()), 0, Library.Sets.Num() - 1);
+	auto& Set = Library.Sets[SetIndex];
+
+	// 点集是周期性的，环绕平移和翻转之后仍然满足最小距离
+	auto Offset = FVector2D(Random.NextUnit(), Random.NextUnit());
+	auto bFlipX = Random.NextUnit() < 0.5;
+	auto bFlipY = Random.NextUnit() < 0.5;
+
+	auto StartSize = OutPoints.Num();
+	OutPoints.SetNumUninitialized(StartSize + Set.Num(), EAllowShrinking::No);
+	for (int32 i = 0; i < Set.Num(); ++i)
+	{
+		auto X = bFlipX ? 1.0 - Set[i].X : double(Set[i].X);
+		auto Y = bFlipY ? 1.0 - Set[i].Y : double(Set[i].Y);
+		X = FMath::Frac(X + Offset.X);
+		Y = FMath::Frac(Y + Offset.Y);
+		OutPoints[StartSize + i] = FVector2D(X * XSize, Y * YSize);
+	}
+	return Set.Num();
+}
+
+int32 AWorldGenerator::PeriodicPoissonSampling(double XSize, double YSize, double MinDistance, int32 SampleCountBeforeReject, FTileRandomStream& Random, FPoissonScratch& Scratch)
+{
+	auto& OutPoints = Scratch.Points;
+	auto& Grid = Scratch.Grid;
+	auto& ActiveList = Scratch.ActiveList;
+	auto StartSize = OutPoints.Num();
+
+	// 网格需要整除 tile，才能在边界处环绕，网格边长不超过 MinDistance / sqrt(2)
+	int32 MaxGridX = FMath::CeilToInt(XSize / (MinDistance / FMath::Sqrt(2.0)));
+	int32 MaxGridY = FMath::CeilToInt(YSize / (MinDistance / FMath::Sqrt(2.0)));
+	double CellX = XSize / MaxGridX;
+	double CellY = YSize / MaxGridY;
+	int32 RangeX = FMath::CeilToInt(MinDistance / CellX);
+	int32 RangeY = FMath::CeilToInt(MinDistance / CellY);
+
+	Grid.SetNumUninitialized(MaxGridX * MaxGridY, EAllowShrinking::No);
+	FMemory::Memset(Grid.GetData(), 0xFF, Grid.Num() * sizeof(int32));
+	ActiveList.SetNum(0, EAllowShrinking::No);
+
+	auto Wrap = [](double Value, double Size) {
+		Value = FMath::Fmod(Value, Size);
+		return Value < 0.0 ? Value + Size : Value;
+	};
+	auto ToroidalDelta = [](double Delta, double Size) {
+		Delta = FMath::Abs(Delta);
+		return FMath::Min(Delta, Size - Delta);
+	};
+	auto AddPoint = [&](FVector2D Point) {
+		auto GridX = FMath::Min(FMath::FloorToInt(Point.X / CellX), MaxGridX - 1);
+		auto GridY = FMath::Min(FMath::FloorToInt(Point.Y / CellY), MaxGridY - 1);
+		auto PointIndex = OutPoints.Add(Point);
+		Grid[GridX * MaxGridY + GridY] = PointIndex;
+		ActiveList.Add(PointIndex);
+	};
+	auto IsValidPoint = [&](FVector2D NewPos) -> bool {
+		auto NewGridX = FMath::Min(FMath::FloorToInt(NewPos.X / CellX), MaxGridX - 1);
+		auto NewGridY = FMath::Min(FMath::FloorToInt(NewPos.Y / CellY), MaxGridY - 1);
+		for (int32 DX = -RangeX; DX <= RangeX; ++DX)
+		{
+			for (int32 DY = -RangeY; DY <= RangeY; ++DY)
+			{
+				auto X = (NewGridX + DX + MaxGridX * (RangeX + 1)) % MaxGridX;
+				auto Y = (NewGridY + DY + MaxGridY * (RangeY + 1)) % MaxGridY;
+				auto PointIndex = Grid[X * MaxGridY + Y];
+				if (PointIndex == INDEX_NONE)
+				{
+					continue;
+				}
+				auto& Other = OutPoints[PointIndex];
+				auto DeltaX = ToroidalDelta(NewPos.X - Other.X, XSize);
+				auto DeltaY = ToroidalDelta(NewPos.Y - Other.Y, YSize);
+				if (DeltaX * DeltaX + DeltaY * DeltaY < MinDistance * MinDistance)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+
+	AddPoint(FVector2D(Random.NextUnit() * XSize, Random.NextUnit() * YSize));
+
+	while (!ActiveList.IsEmpty())
+	{
+		auto Idx = FMath::Clamp(FMath::FloorToInt32(Random.NextUnit() * ActiveList.Num()), 0, ActiveList.Num() - 1);
+		FVector2D ActivePoint = OutPoints[ActiveList[Idx]];
+		int32 i = 0;
+		for (; i < SampleCountBeforeReject; ++i)
+		{
+			auto Radius = Random.NextUnit() * MinDistance + MinDistance;
+			auto Angle = Random.NextUnit() * 2.0 * PI;
+			FVector2D NewPoint = ActivePoint + FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * Radius;
+			NewPoint = FVector2D(Wrap(NewPoint.X, XSize), Wrap(NewPoint.Y, YSize));
+			if (IsValidPoint(NewPoint))
+			{
+				AddPoint(NewPoint);
+				break;
+			}
+		}
+		if (i == SampleCountBeforeReject)
+		{
+			ActiveList.RemoveAtSwap(Idx, 1, EAllowShrinking::No);
+		}
+	}
+	return OutPoints.Num() - StartSize;
+}
+
+int32 AWorldGenerator::SampleGroupPoints(EDistanceFunc Func, double XSize, double YSize, double MinDistance, int32 MaxPoints, int32 SampleCountBeforeReject, FTileRandomStream& Random, FPoissonScratch& Scratch)
+{
+	switch (Func)
+	{
+		case EDistanceFunc::Xaxis:
+			return AxisSpacingSampling<TDistanceFunc<EDistanceFunc::Xaxis>::Axis>(XSize, YSize, MinDistance, MaxPoints, Random, Scratch.Points);
+		case EDistanceFunc::Yaxis:
+			return AxisSpacingSampling<TDistanceFunc<EDistanceFunc::Yaxis>::Axis>(XSize, YSize, MinDistance, MaxPoints, Random, Scratch.Points);
+		case EDistanceFunc::Euclidean:
+		default:
+			return PoissonSampling(XSize, YSize, MinDistance, SampleCountBeforeReject, Random, TDistanceFunc<EDistanceFunc::Euclidean>(), Scratch);
+	}
+}
+
+template <int32 Axis>
+int32 AWorldGenerator::AxisSpacingSampling(double XSize, double YSize, double MinDistance, int32 MaxPoints, FTileRandomStream& Random, TArenaArray<FVector2D>& OutPoints)
+{
+	auto Length = Axis == 0 ? XSize : YSize;
+	auto OtherLength = Axis == 0 ? YSize : XSize;
+
+	// N 个点至少占用 (N - 1) * MinDistance 的长度，剩余的 Slack 随机分配到各个间隔中
+	auto MaxFit = FMath::CeilToInt32(Length / MinDistance);
+	auto Count = FMath::Min(MaxPoints, MaxFit);
+	if (Count <= 0)
+	{
+		return 0;
+	}
+	auto Slack = Length - (Count - 1) * MinDistance;
+
+	// 用归一化的指数分布间隔生成 Count 个有序的 [0, Slack) 均匀随机数，避免排序
+	auto StartSize = OutPoints.Num();
+	OutPoints.SetNumUninitialized(StartSize + Count, EAllowShrinking::No);
+	double Sum = 0.0;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		Sum += -FMath::Loge(1.0 - Random.NextUnit());
+		OutPoints[StartSize + i][Axis] = Sum;
+	}
+	Sum += -FMath::Loge(1.0 - Random.NextUnit()); // 最后一段间隔，保证最大值小于 Slack
+	auto Scale = Slack / Sum;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		auto& Point = OutPoints[StartSize + i];
+		Point[Axis] = Point[Axis] * Scale + i * MinDistance;
+		Point[1 - Axis] = Random.NextUnit() * OtherLength;
+	}
+	return Count;
 }
 
 template <class T>
-int32 AWorldGenerator::PoissonSampling(double XSize, double YSize, double MinDistance, int32 SampleCountBeforeReject, std::mt19937_64& RandomEngine, T DistLambda, TArray<FVector2D>& OutPoints)
+int32 AWorldGenerator::PoissonSampling(double XSize, double YSize, double MinDistance, int32 SampleCountBeforeReject, FTileRandomStream& Random, T DistLambda, FPoissonScratch& Scratch)
 {
+	auto& OutPoints = Scratch.Points;
+	auto& Grid = Scratch.Grid;
+	auto& ActiveList = Scratch.ActiveList;
 	auto StartSize = OutPoints.Num();
 
-	// 计算每个点的网格大小
+	// 计算每个点的网格大小，每个网格中最多只有一个点
 	double CellSize = MinDistance / FMath::Sqrt(2.0);
 	int32 MaxGridX = FMath::CeilToInt(XSize / CellSize);
 	int32 MaxGridY = FMath::CeilToInt(YSize / CellSize);
 
-	// 创建网格
-	TArray<TArray<FVector2D>> Grid;
-	TArray<bool> GridOccupied;
-	TArray<FVector2D> ActiveList;
+	// 复用上一次的内存，全部置为 INDEX_NONE（-1 的每个字节都是 0xFF）
+	Grid.SetNumUninitialized(MaxGridX * MaxGridY, EAllowShrinking::No);
+	FMemory::Memset(Grid.GetData(), 0xFF, Grid.Num() * sizeof(int32));
+	ActiveList.SetNum(0, EAllowShrinking::No);
 
-	Grid.SetNum(MaxGridX);
-	GridOccupied.SetNumZeroed(MaxGridX * MaxGridY);
-	for (int32 X = 0; X < MaxGridX; ++X)
-	{
-		Grid[X].SetNumUninitialized(MaxGridY);
-	}
+	auto AddPoint = [&OutPoints, &Grid, &ActiveList, MaxGridY](FVector2D Point, int32 GridX, int32 GridY) {
+		auto PointIndex = OutPoints.Add(Point);
+		Grid[GridX * MaxGridY + GridY] = PointIndex;
+		ActiveList.Add(PointIndex);
+	};
 
 	// 生成第一个点
-	std::uniform_real_distribution<double> Generator(0.0, 1.0);
-	FVector2D FirstPoint = FVector2D(Generator(RandomEngine) * XSize, Generator(RandomEngine) * YSize);
-	OutPoints.Add(FirstPoint);
-	ActiveList.Add(FirstPoint);
-	auto FirstGridX = FMath::FloorToInt(FirstPoint.X / CellSize);
-	auto FirstGridY = FMath::FloorToInt(FirstPoint.Y / CellSize);
-	Grid[FirstGridX][FirstGridY] = FirstPoint;
-	GridOccupied[FirstGridX * MaxGridY + FirstGridY] = true;
-
-	auto IsValidPoint = [&GridOccupied, &Grid, DistLambda, XSize, YSize, MinDistance, MaxGridX, MaxGridY](FVector2D NewPos, int32 NewGridX, int32 NewGridY) -> bool {
+	FVector2D FirstPoint = FVector2D(Random.NextUnit() * XSize, Random.NextUnit() * YSize);
+	AddPoint(FirstPoint, FMath::FloorToInt(FirstPoint.X / CellSize), FMath::FloorToInt(FirstPoint.Y / CellSize));
+
+	auto IsValidPoint = [&OutPoints, &Grid, DistLambda, XSize, YSize, MinDistance, MaxGridX, MaxGridY](FVector2D NewPos, int32 NewGridX, int32 NewGridY) -> bool {
 		if (NewPos.X < 0 || NewPos.X >= XSize || NewPos.Y < 0 || NewPos.Y >= YSize)
 		{
 			return false; // 点在网格外
@@ -1544,7 +2494,8 @@ int32 AWorldGenerator::PoissonSampling(double XSize, double YSize, double MinDis
 		{
 			for (int32 Y = FMath::Max(0, NewGridY - 2); Y <= FMath::Min(MaxGridY - 1, NewGridY + 2); ++Y)
 			{
-				if (GridOccupied[X * MaxGridY + Y] && DistLambda(NewPos, Grid[X][Y], MinDistance))
+				auto PointIndex = Grid[X * MaxGridY + Y];
+				if (PointIndex != INDEX_NONE && DistLambda(NewPos, OutPoints[PointIndex], MinDistance))
 				{
 					return false;
 				}
@@ -1556,15 +2507,13 @@ int32 AWorldGenerator::PoissonSampling(double XSize, double YSize, double MinDis
 	// 进行采样
 	while (!ActiveList.IsEmpty())
 	{
-		auto Idx = FMath::Clamp(FMath::FloorToInt32(Generator(RandomEngine) * ActiveList.Num()), 0, ActiveList.Num() - 1);
-		FVector2D ActivePoint = ActiveList[Idx];
+		auto Idx = FMath::Clamp(FMath::FloorToInt32(Random.NextUnit() * ActiveList.Num()), 0, ActiveList.Num() - 1);
+		FVector2D ActivePoint = OutPoints[ActiveList[Idx]];
 		int32 i = 0;
 		for (; i < SampleCountBeforeReject; ++i)
 		{
-			// auto Radius = FMath::FRand() * MinDistance + MinDistance;
-			// auto Angle = FMath::FRand() * 2.0 * PI;
-			auto Radius = Generator(RandomEngine) * MinDistance + MinDistance;
-			auto Angle = Generator(RandomEngine) * 2.0 * PI;
+			auto Radius = Random.NextUnit() * MinDistance + MinDistance;
+			auto Angle = Random.NextUnit() * 2.0 * PI;
 			FVector2D NewPoint = ActivePoint + FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * Radius;
 			auto NewGridX = FMath::FloorToInt(NewPoint.X / CellSize);
 			auto NewGridY = FMath::FloorToInt(NewPoint.Y / CellSize);
@@ -1572,23 +2521,21 @@ int32 AWorldGenerator::PoissonSampling(double XSize, double YSize, double MinDis
 			// 检查新点是否有效
 			if (IsValidPoint(NewPoint, NewGridX, NewGridY))
 			{
-				OutPoints.Add(NewPoint);
-				Grid[NewGridX][NewGridY] = NewPoint;
-				GridOccupied[NewGridX * MaxGridY + NewGridY] = true;
-				ActiveList.Add(NewPoint);
+				AddPoint(NewPoint, NewGridX, NewGridY);
 				break;
 			}
 		}
 		if (i == SampleCountBeforeReject)
 		{
-			// 如果没有找到有效的点，则从活动列表中移除当前点
-			ActiveList.RemoveAt(Idx);
+			// 如果没有找到有效的点，则从活动列表中移除当前点，活动列表的顺序无关紧要
+			ActiveList.RemoveAtSwap(Idx, 1, EAllowShrinking::No);
 		}
 	}
 
 	auto EndSize = OutPoints.Num();
 	return EndSize - StartSize; // 返回生成的点数
 }
+
 void AWorldGenerator::OnConstruction(const FTransform& Transform)
 {
 	Super::OnConstruction(Transform);
@@ -1599,9 +2546,12 @@ void AWorldGenerator::OnConstruction(const FTransform& Transform)
 	}
 
 	InitDataBuffer();
+	RebuildGenConfig();
 
 	auto PosOffset = FVector2D(double(CellSize) * XCellNumber / 2, double(CellSize) * YCellNumber / 2);
-	GenerateOneTileAsync(0, 0, 0, FInt32Point(0, 0), PosOffset);
+	// 编辑器预览直接在当前线程上依次执行 worker 阶段
+	GenerateHeightsAsync(*GenConfig, 0, FInt32Point(0, 0), PosOffset);
+	GenerateNormalsAsync(*GenConfig, 0);
 
 	auto& Vertices = TaskDataBuffers[0].VerticesBuffer;
 	if (DrawType == EDrawType::Gaussian)
@@ -1614,7 +2564,6 @@ void AWorldGenerator::OnConstruction(const FTransform& Transform)
 	auto& NormalsBuffer = TaskData.NormalsBuffer;
 	auto& UV0Buffer = TaskData.UV0Buffer;
 	auto& TangentsBuffer = TaskData.TangentsBuffer;
-	auto& RandomPoints = TaskData.RandomPoints;
 
 	auto Tile = TilesInBuilding[0];
 	UProceduralMeshComponent* PMC = nullptr;
@@ -1642,6 +2591,12 @@ void AWorldGenerator::PostEditChangeProperty(FPropertyChangedEvent& PropertyChan
 {
 	Super::PostEditChangeProperty(PropertyChangedEvent);
 
+	// 运行时调整参数，之后派发的 tile 使用新的快照，正在生成的 tile 不受影响
+	if (HasActorBegunPlay())
+	{
+		RebuildGenConfig(true);
+	}
+
 	if (PropertyChangedEvent.Property && PropertyChangedEvent.Property->GetFName() == GET_MEMBER_NAME_CHECKED(AWorldGenerator, DrawType))
 	{
 		// Handle changes to the DrawType property
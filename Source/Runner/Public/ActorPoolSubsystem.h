@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Templates/SubclassOf.h"
+#include "ActorPoolSubsystem.generated.h"
+
+USTRUCT()
+struct FActorPoolEntry
+{
+	GENERATED_BODY()
+
+	// 空闲的 actor，tick、碰撞和可见性都已关闭
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<AActor>> FreeActors;
+};
+
+// 按类缓存 spawner 生成的 actor，预热之后 tile 的生成和移除不再调用 SpawnActor 和 Destroy
+UCLASS()
+class RUNNER_API UActorPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UActorPoolSubsystem* Get(const UObject* WorldContextObject);
+
+	// 取出一个 Class 的 actor 放到 Transform，池为空时才会 SpawnActor
+	// bFailIfColliding 与 ESpawnActorCollisionHandlingMethod::DontSpawnIfColliding 相同，和阻挡的几何体重叠时返回 nullptr
+	AActor* Acquire(TSubclassOf<AActor> Class, const FTransform& Transform, bool bFailIfColliding = false);
+
+	// 放回池中，Actor 必须是 Acquire 得到的
+	void Release(AActor* Actor);
+
+	// 保证池中至少有 Count 个空闲的 actor
+	void Prewarm(TSubclassOf<AActor> Class, int32 Count);
+
+	int32 GetNumFree(TSubclassOf<AActor> Class) const;
+
+	// 调用 OnReturnedToPool 并关闭 actor 和组件的 tick、碰撞和可见性，但不放回池中
+	// 用于被收集或被移除的 actor，它仍然属于生成它的 spawner，在 tile 移除时由 spawner 放回
+	static void Park(AActor* Actor);
+
+	void Deinitialize() override;
+
+protected:
+	bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	AActor* SpawnPooledActor(UClass* Class, const FTransform& Transform);
+	static void Activate(AActor* Actor, const FTransform& Transform);
+
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UClass>, FActorPoolEntry> Pools;
+
+	int32 NumSpawned = 0; // 池一共 spawn 过的 actor 数量，预热足够时不应在运行中增长
+};
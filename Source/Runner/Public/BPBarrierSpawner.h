@@ -3,9 +3,9 @@
 #pragma once
 
 #include "Containers/Array.h"
-#include "Containers/Map.h"
 #include "CoreMinimal.h"
 #include "BarrierSpawner.h"
+#include "TileSlots.h"
 #include "UObject/ObjectPtr.h"
 #include "UObject/WeakObjectPtrTemplates.h"
 
@@ -19,19 +19,31 @@ class RUNNER_API ABPBarrierSpawner : public ABarrierSpawner
 	GENERATED_BODY()
 	
 public:
-	void SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator) override;
+	bool SpawnBarriers(FBarrierSpawnContext& Context) override;
 	void RemoveTile(FInt32Point Tile) override;	
 	void MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX) override;
+	SIZE_T GetTileStorageAllocatedSize() const override { return SpawnedBarriers.GetAllocatedSize(); }
 
 	UPROPERTY(EditAnywhere, Category = "Barrier Spawner")
 	TSubclassOf<AActor> BarrierClass; // 用于生成障碍物的类
 
-	UPROPERTY(EditAnywhere, Category = "Barrier Spawner")
-	int32 MaxCachedBarriers = 10; // 最大缓存障碍物数量
+	// 每个难度下同时存在的 BarrierClass 数量，BeginPlay 时按其中的最大值预热对象池
+	// 为空时按 MaxBarrierCount 的最大值乘以同时存在的 tile 数量预热
+	UPROPERTY(EditAnywhere, Category = "Barrier Spawner|Pool")
+	TArray<int32> PoolSizePerDifficulty;
 
 protected:
-	TArray<TWeakObjectPtr<AActor>> CachedBarriers; // 存储缓存的障碍物实例
+	void BeginPlay() override;
+
+	// 没有配置 PoolSizePerDifficulty 时 BarrierClass 的预热数量，每个点生成多个 actor 的子类需要重写
+	virtual int32 GetDefaultPoolSize() const;
+
+	// Count 是 BarrierClass 需要预热的数量，子类可以预热其它会用到的类
+	virtual void PrewarmPool(class UActorPoolSubsystem& Pool, int32 Count) const;
+
+	// 从对象池取出 Class 的 actor，记录到 Tile 上，tile 移除时放回对象池
+	AActor* AcquireBarrier(TSubclassOf<AActor> Class, const FTransform& Transform, FInt32Point Tile, bool bFailIfColliding = false);
 
-	// 保证生成的 Actor 仅由该 BarrierSpawner 管理，可以不使用 UPROPERTY
-	TMultiMap<FInt32Point, TWeakObjectPtr<AActor>> SpawnedBarriers; // 存储生成的障碍物实例
+	// actor 由对象池持有，这里只记录每个 tile 上的 actor
+	TTileSlots<TArray<TWeakObjectPtr<AActor>>> SpawnedBarriers; // 存储生成的障碍物实例
 };
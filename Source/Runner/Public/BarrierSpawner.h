@@ -19,6 +19,53 @@ enum class EAlignMode : uint8
 	AlignGravity, // 对齐到重力方向
 };
 
+// 一帧内 spawn 障碍物的预算，用完之后 spawner 应当让出，下一帧从上次的位置继续
+struct FSpawnBudget
+{
+	FSpawnBudget() = default;
+	FSpawnBudget(int32 InMaxInstances, double InMicroseconds)
+			: RemainingInstances(InMaxInstances)
+			, Deadline(FPlatformTime::Seconds() + InMicroseconds * 1e-6)
+	{
+	}
+
+	int32 RemainingInstances = MAX_int32;
+	double Deadline = TNumericLimits<double>::Max();
+
+	bool IsExhausted() const
+	{
+		return RemainingInstances <= 0 || FPlatformTime::Seconds() >= Deadline;
+	}
+	void Consume(int32 Count = 1)
+	{
+		RemainingInstances -= Count;
+	}
+	// 用于地形网格这类一次性且昂贵的工作，执行后本帧不再做其它工作
+	void ConsumeAll()
+	{
+		RemainingInstances = 0;
+	}
+};
+
+// 一个 spawner 在一个 tile 上的 spawn 过程，可能会跨越多帧
+struct FBarrierSpawnContext
+{
+	FSpawnSeedView Positions;
+	FInt32Point Tile;
+	AWorldGenerator* WorldGenerator = nullptr;
+	FSpawnBudget* Budget = nullptr;
+	int32 SpawnerIndex = 0; // 在 AWorldGenerator::BarrierSpawners 中的下标，用于区分随机流
+	const FSpawnPlan* Plan = nullptr; // worker 阶段的规划结果，在整个 spawn 过程中有效
+
+	int32 Cursor = 0;				// 下一个需要处理的点
+	int32 SpawnerState = 0; // spawner 自定义的跨帧状态
+	bool bResumed = false;	// 这个 tile 上已经调用过 SpawnBarriers，即使 Cursor 为 0
+
+	bool IsFinished() const { return Cursor >= Positions.Num(); }
+	// 还有剩余的点但是预算已经用完
+	bool ShouldYield() const { return !IsFinished() && Budget->IsExhausted(); }
+};
+
 UCLASS(Abstract)
 class RUNNER_API ABarrierSpawner : public AActor
 {
@@ -28,8 +75,8 @@ public:
 	// Sets default values for this actor's properties
 	ABarrierSpawner();
 
-	// 这些变量仅允许在编辑器中修改，不能在运行时修改，并且可能被其它线程访问
-	// 但 UE 不支持把这些成员变量标记为 const
+	// 这些变量仅允许在编辑器中修改，worker 线程通过 FWorldGenConfig 快照读取它们
+	// 运行时修改之后需要调用 AWorldGenerator::RebuildGenConfig
 	UPROPERTY(EditAnywhere, Category = "Barrier Spawner")
 	EAlignMode AlignMode = EAlignMode::AlignGravity; // 对齐模式
 
@@ -57,34 +104,42 @@ public:
 	bool bDeferSpawn = false; // 是否延迟 spawn，默认不延迟
 
 protected:
-	void TransformAlign(FVector& Location, FRotator& Rotation, AWorldGenerator* WorldGenerator) const;
-	void GetTransformFromSeed(FTransform& OutTransform, const RandomPoint& Seed, FInt32Point Tile, AWorldGenerator* WorldGenerator) const;
+	// Context.Cursor 对应的点的 transform，已经由 worker 计算好（见 SpawnTransform::FromSeeds），这里只需要换算到当前的原点
+	void GetTransformFromSeed(FTransform& OutTransform, const FBarrierSpawnContext& Context) const;
 
+	// 每个分量应当是种子的一次函数，FillGenConfig 由此得到 worker 使用的旋转规则，否则 transform 退回 game 线程上计算
 	virtual FRotator GetRotationFromSeed(FRotator Seed) const;
 
 public:
+	// 把 worker 需要的参数写入快照，在 AWorldGenerator::RebuildGenConfig 中调用
+	virtual void FillGenConfig(FSpawnerGenConfig& OutConfig) const;
+
 	bool CanSpawnThisBarrier(FInt32Point Tile, FVector2D UVPos, AWorldGenerator* WorldGenerator) const;
 
-	virtual void SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator) {}
-	virtual FVector2D PreSpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator) { return FVector2D::ZeroVector; }
-	virtual bool DeferSpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, FVector2D UVPos, AWorldGenerator* WorldGenerator) { return true; }
-	virtual void RemoveTile(FInt32Point Tile) {}
-	virtual int32 GetBarrierCountAnyThread(double RandomValue, int32 Difficulty) const
+	// 从 Context.Cursor 开始 spawn，预算用完时返回 false，之后会以同一个 Context 再次被调用，全部完成时返回 true
+	virtual bool SpawnBarriers(FBarrierSpawnContext& Context)
 	{
-		ensure(MinBarrierCount.Num() > 0 && MaxBarrierCount.Num() > 0);
-		auto MinCount = MinBarrierCount.IsValidIndex(Difficulty) ? MinBarrierCount[Difficulty] : MinBarrierCount[MinBarrierCount.Num() - 1];
-		auto MaxCount = MaxBarrierCount.IsValidIndex(Difficulty) ? MaxBarrierCount[Difficulty] : MaxBarrierCount[MaxBarrierCount.Num() - 1];
-
-		if (MaxCount <= 0)
-		{
-			return 0;
-		}
-		auto BarCount = FMath::RoundToInt(float(FMath::Lerp(MinCount, MaxCount, RandomValue)));
-		// 当 MaxCount 大于 0 时，确保至少生成一个障碍物
-		return FMath::Max(BarCount, 1);
+		Context.Cursor = Context.Positions.Num();
+		return true;
 	}
+	// 返回需要预留的位置（UV），延迟 spawn 之前这里不会生成其它障碍物
+	virtual FVector2D PreSpawnBarriers(FSpawnSeedView Positions, FInt32Point Tile, const FSpawnPlan& Plan, AWorldGenerator* WorldGenerator) { return FVector2D::ZeroVector; }
+	// 返回 false 表示还缺少 OutMissingTile，它 commit 之后会再次调用
+	virtual bool DeferSpawnBarriers(FSpawnSeedView Positions, FInt32Point Tile, const FSpawnPlan& Plan, AWorldGenerator* WorldGenerator, FInt32Point& OutMissingTile) { return true; }
+	// 延迟 spawn 依赖的 tile，该 tile commit 之后才会调用 DeferSpawnBarriers
+	virtual FInt32Point GetDeferredSpawnDependency(FInt32Point Tile) const { return Tile; }
+	virtual void RemoveTile(FInt32Point Tile) {}
 	virtual void MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX) {}
+	// 按 tile 存放的容器在堆上的容量，AWorldGenerator 据此统计稳态下的堆分配
+	virtual SIZE_T GetTileStorageAllocatedSize() const { return 0; }
 
 	virtual bool BarrierHasCustomSlope() const { return false; }
-	virtual double GetCustomSlopeAngle(int32 InstanceIndex) const { return 0.0; }
+	// Component 和 InstanceIndex 来自碰撞结果
+	virtual double GetCustomSlopeAngle(const UPrimitiveComponent* Component, int32 InstanceIndex) const { return 0.0; }
+
+	// 实例被重新编号（例如压缩 ISM）的次数，缓存了碰撞结果中 Item 的调用者据此判断编号是否还有效
+	uint32 GetInstanceRemapSerial() const { return InstanceRemapSerial; }
+
+protected:
+	uint32 InstanceRemapSerial = 0;
 };
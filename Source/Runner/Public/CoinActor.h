@@ -4,10 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "ReusableActor.h"
 #include "CoinActor.generated.h"
 
 UCLASS()
-class RUNNER_API ACoinActor : public AActor
+class RUNNER_API ACoinActor : public AActor, public IReusableActor
 {
 	GENERATED_BODY()
 	
@@ -30,6 +31,11 @@ public:
 
 	float CurrentAttractTime = 0.0f;
 
+	// 材质是否通过 custom primitive data 完成旋转、晃动等外观上的运动（各子类的头文件中有数据的编号约定）
+	// 为 false 时这些运动退回到 TickMotion 中，actor 一直 tick
+	UPROPERTY(EditDefaultsOnly, Category = "Default")
+	bool bMaterialDrivesMotion = false;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -38,6 +44,15 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	// 金币由对象池复用，取出时清除上一次被吸引的状态
+	void OnAcquiredFromPool_Implementation() override;
+
+protected:
+	// 旋转、晃动等外观上的运动放在材质中（WPO），只有被吸引时才需要 tick
+	virtual void StartAttract();
+	// 材质不负责运动时每帧调用
+	virtual void TickMotion(float DeltaTime) {}
+
 	UFUNCTION()
 	void DealOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
 
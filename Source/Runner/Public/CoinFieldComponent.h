@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "CoinFieldComponent.generated.h"
+
+struct FISMInstanceBatch;
+
+// 用一个 ISM 渲染所有金币，金币的状态按 SoA 存放，下标就是实例编号
+// 金币没有碰撞和 tick，吸引和拾取每帧对玩家的 Activate/Absorb 球体做一次距离检测，旋转放在材质中（WPO）
+// custom primitive data 的编号和 ARunnerCoinActor 相同（组件级，所有实例共用），模板的材质不读取它时在 tick 中旋转实例
+UCLASS(ClassGroup = (Runner), meta = (BlueprintSpawnableComponent))
+class RUNNER_API UCoinFieldComponent : public UInstancedStaticMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCoinFieldComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	// 金币的半径，和玩家的球体相交时被吸引或拾取，InitFromTemplate 时换成模板碰撞球的半径
+	UPROPERTY(EditAnywhere, Category = "Coin Field")
+	float CoinRadius = 50.0f;
+
+	// 被吸引之后飞到玩家处的时间
+	UPROPERTY(EditAnywhere, Category = "Coin Field")
+	float AttractTime = 1.0f;
+
+	// 从原来逐个 spawn 的金币 actor 的默认对象复制外观和碰撞
+	// 没有设置网格体时复制模板的网格体、材质和阴影，模板的碰撞球决定 CoinRadius 和 spawn 时的阻挡检测
+	// 模板是 ARunnerCoinActor 时它的 SpinSpeed 同样通过 custom primitive data 传给材质，没有勾选 bMaterialDrivesMotion 时改为 tick 中旋转
+	void InitFromTemplate(const class ACoinActor* Template);
+
+	// 模板没有碰撞球时 spawn 使用的阻挡检测
+	void SetBlockingTest(float Radius, ECollisionChannel ObjectType);
+	float GetBlockingRadius() const { return BlockingRadius; }
+
+	// 和阻挡的几何体重叠则不生成，和模板 actor 的 DontSpawnIfColliding 一致
+	bool IsBlocked(const FVector& Position) const;
+
+	// 金币实例的 transform，包括模板网格体相对 actor 的 transform
+	FTransform MakeCoinTransform(const FRotator& Rotation, const FVector& Position) const { return MeshTransform * FTransform(Rotation, Position); }
+
+	// 提交 Batch 中的金币（世界坐标），用到的编号追加到 OutIndices
+	void AddCoins(FISMInstanceBatch& Batch, TArray<int32>& OutIndices);
+	// 回收金币，已经被拾取的金币也要在这里回收
+	void RemoveCoins(TConstArrayView<int32> CoinIndices);
+	void MoveWorldOrigin(double WorldOffsetX);
+
+	int32 GetNumActiveCoins() const { return NumActiveCoins; }
+
+	void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+	enum class ECoinState : uint8
+	{
+		Free,			 // 空闲的实例，已隐藏
+		Idle,			 // 等待玩家靠近
+		Attracted, // 正在飞向玩家
+		Collected, // 已被拾取并隐藏，等 tile 移除时回收
+	};
+
+	// 查找玩家和它的 Activate/Absorb 球体，找不到时返回 false
+	bool GetPlayerSpheres(FSphere& OutActivate, FSphere& OutAbsorb);
+	void SetActiveCoins(int32 Number);
+
+	TWeakObjectPtr<class ARunnerCharacter> Player;
+	TWeakObjectPtr<UPrimitiveComponent> ActivateComp;
+
+	float BlockingRadius = 0.0f;
+	TEnumAsByte<ECollisionChannel> BlockingObjectType = ECC_WorldDynamic;
+	FCollisionResponseParams BlockingResponses;
+	FTransform MeshTransform;
+	float TickSpinSpeed = 0.0f; // 材质不负责旋转时在 tick 中每秒旋转的角度
+
+	TArray<FVector> Positions;
+	TArray<FQuat> Rotations;
+	TArray<float> AttractElapsed;
+	TArray<ECoinState> States;
+
+	TArray<int32> FreeCoins;
+	TArray<int32> CollectedCoins; // 每帧使用的临时数组
+	TArray<int32> MovedCoins;			// 这一帧移动的金币，编号升序
+	TArray<FTransform> MovedTransforms;
+	TArray<FTransform> RunTransforms;
+	// 移动的金币按编号的连续区间批量提交，最后只标记一次 render state
+	void CommitMovedCoins();
+	int32 NumActiveCoins = 0;		 // Idle 和 Attracted 的数量，为 0 时不 tick
+};
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SpawnPlan.h"
+
+struct FWorldGenConfig;
+
+// 地形高度的采样器，不访问任何 UObject，可以在任意线程中使用
+// 采样点位于 Tile 上时读取 worker 刚生成的高度图，否则由 FWorldGenConfig 直接计算，两者都和最终的地形网格一致
+struct FTerrainHeightSampler
+{
+	explicit FTerrainHeightSampler(const FWorldGenConfig& InConfig)
+			: Config(InConfig)
+	{
+	}
+	FTerrainHeightSampler(const FWorldGenConfig& InConfig, FInt32Point InTile, TConstArrayView<FVector> InVertices, TConstArrayView<FVector> InNormals = {})
+			: Config(InConfig)
+			, Tile(InTile)
+			, Vertices(InVertices)
+			, Normals(InNormals)
+	{
+	}
+
+	// Pos 是 Config 对应的世界原点下的水平坐标
+	double GetHeight(FVector2D Pos) const;
+	// 和 AWorldGenerator::GetNormalFromHorizontalPos 一致，没有法线缓冲的 tile 使用三角形的面法线
+	FVector GetNormal(FVector2D Pos) const;
+
+private:
+	// Pos 所在的三角形：三个顶点的格子坐标和重心坐标
+	struct FTriangleSample
+	{
+		FInt32Point Tile;
+		FInt32Point Corners[3];
+		double Weights[3];
+	};
+	FTriangleSample GetTriangle(FVector2D Pos) const;
+	double GetVertexHeight(FInt32Point VertexTile, int32 X, int32 Y) const;
+
+	const FWorldGenConfig& Config;
+	FInt32Point Tile = FInt32Point(INT32_MAX, INT32_MAX);
+	TConstArrayView<FVector> Vertices;
+	TConstArrayView<FVector> Normals;
+};
+
+namespace CoinTrajectory
+{
+	// 在 tile 的 V 这一行上寻找可以起飞的山脊，返回起飞点的 UV，没有找到时返回 (-1, -1)
+	FVector2D FindTakeoffUV(const FWorldGenConfig& Config, const FCoinTrajectoryParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, double V);
+
+	// 按玩家在空中的运动积分出金币的位置，金币碰到地面或者达到 MaxCoinNumber 时停止
+	void Integrate(const FCoinTrajectoryParams& Params, const FTerrainHeightSampler& Sampler, FVector StartPos, double StartZVelocity, TArray<FVector>& OutPositions);
+
+	// 地面上的金币轨迹：寻找起飞点并积分，结果写入 OutPlan
+	void PlanGroundTrace(const FWorldGenConfig& Config, const FCoinTrajectoryParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, double V, FSpawnPlan& OutPlan);
+} // namespace CoinTrajectory
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "BarrierSpawner.h"
+#include "TileSlots.h"
 #include "DecalSpawner.generated.h"
 
 /**
@@ -35,13 +36,14 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Debug")
 	bool bShowSphere = false;
 
-	void SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator) override;
+	bool SpawnBarriers(FBarrierSpawnContext& Context) override;
 	void RemoveTile(FInt32Point Tile) override;
 	void MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX) override;
+	SIZE_T GetTileStorageAllocatedSize() const override { return SpawnedDecals.GetAllocatedSize() + CachedDecals.GetAllocatedSize(); }
 
 	FRotator GetRotationFromSeed(FRotator Seed) const override;
 
 private:
-	TMap<FInt32Point, TArray<class UDecalComponent*>> SpawnedDecals; // 存储生成的 Decal 实例
+	TTileSlots<TArray<class UDecalComponent*>> SpawnedDecals; // 存储生成的 Decal 实例
 	TArray<class UDecalComponent*> CachedDecals;										 // 用于缓存已生成的 Decal 实例
 };
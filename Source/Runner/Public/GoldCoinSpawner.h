@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "BPBarrierSpawner.h"
+#include "ISMInstanceBatch.h"
 #include "Math/MathFwd.h"
 #include "Templates/SubclassOf.h"
 
@@ -20,6 +21,11 @@ class RUNNER_API AGoldCoinSpawner : public ABPBarrierSpawner
 public:
 	AGoldCoinSpawner();
 
+	// 金币都由这个组件渲染，只有道具和云是 actor
+	// BarrierClass 只作为金币的模板（ACoinActor），提供网格体、材质和碰撞球
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Barrier Spawner")
+	TObjectPtr<class UCoinFieldComponent> CoinField;
+
 	// spawn 金币的间隔时间
 	UPROPERTY(EditAnywhere, Category = "Barrier Spawner")
 	float SpawnTimeInterval = 0.1f;
@@ -61,17 +67,32 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Items")
 	TArray<float> ItemProbabilities; // 每个 Item 的概率
 
-	void SpawnDeferredBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, FVector2D UVPos, AWorldGenerator* WorldGenerator);
-	FVector2D PreSpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator) override;
-	bool DeferSpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, FVector2D UVPos, AWorldGenerator* WorldGenerator) override;
+	UPROPERTY(EditAnywhere, Category = "Items")
+	int32 ItemPoolSize = 4; // 云和每种道具预热的数量
+
+	void SpawnDeferredBarriers(FSpawnSeedView Positions, FInt32Point Tile, const FSpawnPlan& Plan, AWorldGenerator* WorldGenerator);
+	FVector2D PreSpawnBarriers(FSpawnSeedView Positions, FInt32Point Tile, const FSpawnPlan& Plan, AWorldGenerator* WorldGenerator) override;
+	bool DeferSpawnBarriers(FSpawnSeedView Positions, FInt32Point Tile, const FSpawnPlan& Plan, AWorldGenerator* WorldGenerator, FInt32Point& OutMissingTile) override;
+	void FillGenConfig(FSpawnerGenConfig& OutConfig) const override;
+	void RemoveTile(FInt32Point Tile) override;
+	void MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX) override;
+	SIZE_T GetTileStorageAllocatedSize() const override { return Super::GetTileStorageAllocatedSize() + SpawnedCoins.GetAllocatedSize() + PendingCoins.GetAllocatedSize(); }
+	FInt32Point GetDeferredSpawnDependency(FInt32Point Tile) const override { return FInt32Point(Tile.X + 1, Tile.Y); }
 
 protected:
 	class AISMBridgeSpawner* BridgeSpawner;
 
 	void BeginPlay() override;
+	void PrewarmPool(class UActorPoolSubsystem& Pool, int32 Count) const override;
+
+	// 地面上的轨迹由 worker 规划，桥上的轨迹依赖桥的实例，在 game 线程上用同样的参数积分
+	FCoinTrajectoryParams GetTrajectoryParams() const;
+	// 按规划好的位置 spawn 金币和道具，Shift 用于换算到当前的世界原点
+	int32 SpawnGoldTrace(TConstArrayView<FVector> Positions, FVector Shift, double StartYaw, FInt32Point Tile, class AWorldGenerator* WorldGenerator, FVector2D RandomSeed);
+	TArray<FVector> BridgeTracePositions; // 桥上轨迹的临时数据
 
-	int32 GenerateGoldTrace(FVector WorldStartPos, double StartYaw, double StartZVelocity, FInt32Point Tile, class AWorldGenerator* WorldGenerator, FVector2D RandomSeed);
-	FVector2D GetCurrentGroundDirection(double time);
+	FISMInstanceBatch PendingCoins;
+	TTileSlots<TArray<int32>> SpawnedCoins; // 每个 tile 上的金币在 CoinField 中的编号
 
 	bool CanGenerateCloudTrace(AWorldGenerator* WorldGenerator, double TilePos) const;
 	void GenerateCloudTrace(FVector ItemPos, FInt32Point Tile);
@@ -3,10 +3,13 @@
 #pragma once
 
 #include "Components/InstancedStaticMeshComponent.h"
-#include "Containers/Map.h"
 #include "CoreMinimal.h"
+#include "Engine/TimerHandle.h"
 #include "BarrierSpawner.h"
+#include "ISMInstanceBatch.h"
+#include "ISMRenderSettings.h"
 #include "Math/MathFwd.h"
+#include "TileSlots.h"
 #include "ISMBarrierSpawner.generated.h"
 
 /**
@@ -20,20 +23,59 @@ class RUNNER_API AISMBarrierSpawner : public ABarrierSpawner
 public:
 	AISMBarrierSpawner();
 
-	void SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator) override;
+	bool SpawnBarriers(FBarrierSpawnContext& Context) override;
 	void RemoveTile(FInt32Point Tile) override;
 	void MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX) override;
+	SIZE_T GetTileStorageAllocatedSize() const override
+	{
+		return TileInstanceIndices.GetAllocatedSize() + ReplaceInstanceIndices.GetAllocatedSize() + PendingInstances.GetAllocatedSize() + TileComponents.GetAllocatedSize();
+	}
 
 	const TArray<int32>* GetInstanceInTile(FInt32Point Tile) const { return TileInstanceIndices.Find(Tile); };
+	// GetInstanceInTile 返回的实例编号所在的组件
+	UInstancedStaticMeshComponent* GetComponentInTile(FInt32Point Tile) const;
 
 	UPROPERTY(EditAnywhere, Category = "Barrier Spawner")
 	UInstancedStaticMeshComponent* ISMComponent;
 
+	// 每个 tile 的实例放在单独的 ISM 组件中（以 ISMComponent 为模板），移动原点时只需要平移组件，移除 tile 时整个组件回收
+	UPROPERTY(EditAnywhere, Category = "Barrier Spawner")
+	bool bComponentPerTile = false;
+
+	UPROPERTY(EditAnywhere, Category = "Barrier Spawner")
+	FISMRenderSettings RenderSettings;
+
+	// 每隔多少秒压缩 ISMComponent，把存活的实例移到前面并删除空闲实例，<= 0 时不压缩
+	UPROPERTY(EditAnywhere, Category = "Barrier Spawner")
+	float CompactInterval = 2.0f;
+
+	// 每帧压缩时最多移动的实例数，剩下的空洞在之后的帧继续
+	UPROPERTY(EditAnywhere, Category = "Barrier Spawner", meta = (ClampMin = "1"))
+	int32 MaxCompactMovesPerFrame = 256;
+
 protected:
+	void BeginPlay() override;
+	void CompactInstances();
+
 	// 每个 tile 上的静态网格体实例编号
-	TMap<FInt32Point, TArray<int32>> TileInstanceIndices;
+	TTileSlots<TArray<int32>> TileInstanceIndices;
 
-	// 存储了可复用的静态网格体实例
+	// 存储了可复用的静态网格体实例，这些实例已经被隐藏
 	TArray<int32> ReplaceInstanceIndices;
+	FTimerHandle CompactTimerHandle;
+	TMap<int32, int32> CompactRemap; // 压缩时使用的临时数据
+
+	// 这一帧待提交的实例
+	FISMInstanceBatch PendingInstances;
+
+	// bComponentPerTile 时使用
+	UInstancedStaticMeshComponent* AcquireTileComponent(FInt32Point Tile);
+	void ReleaseTileComponent(FInt32Point Tile);
+
+	TTileSlots<UInstancedStaticMeshComponent*> TileComponents;
+	TArray<UInstancedStaticMeshComponent*> FreeTileComponents;
+	// 创建过的所有 tile 组件
+	UPROPERTY(Transient)
+	TArray<UInstancedStaticMeshComponent*> TileComponentPool;
 
 };
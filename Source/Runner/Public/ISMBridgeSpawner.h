@@ -23,10 +23,11 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Barrier Spawner")
 	float MaxBridgeAngle = 45.0f; // 最大桥梁角度
 
-	void SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator) override;
+	void FillGenConfig(FSpawnerGenConfig& OutConfig) const override;
+	bool SpawnBarriers(FBarrierSpawnContext& Context) override;
 
 	bool BarrierHasCustomSlope() const override { return true; }
-	double GetCustomSlopeAngle(int32 InstanceIndex) const override;
+	double GetCustomSlopeAngle(const UPrimitiveComponent* Component, int32 InstanceIndex) const override;
 
 protected:
 	FRotator GetRotationFromSeed(FRotator Seed) const override;
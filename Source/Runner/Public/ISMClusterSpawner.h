@@ -3,7 +3,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Engine/TimerHandle.h"
 #include "BarrierSpawner.h"
+#include "ISMInstanceBatch.h"
+#include "ISMRenderSettings.h"
+#include "TileSlots.h"
 #include "UObject/NameTypes.h"
 #include "UObject/UnrealType.h"
 
@@ -35,11 +39,23 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Cluster Spawner")
 	int32 TryTimeBeforeGiveUp = 10; // 在放置 mesh 时，尝试的次数
 
+	UPROPERTY(EditAnywhere, Category = "Cluster Spawner")
+	FISMRenderSettings RenderSettings;
+
+	UPROPERTY(EditAnywhere, Category = "Cluster Spawner")
+	float CompactInterval = 2.0f; // 每隔多少秒压缩各个 ISM，删除空闲实例，<= 0 时不压缩
+
+	// 每帧压缩时所有 ISM 一共最多移动的实例数，剩下的空洞在之后的帧继续
+	UPROPERTY(EditAnywhere, Category = "Cluster Spawner", meta = (ClampMin = "1"))
+	int32 MaxCompactMovesPerFrame = 256;
+
 	AISMClusterSpawner();
 
-	void SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator) override;
+	void FillGenConfig(FSpawnerGenConfig& OutConfig) const override;
+	bool SpawnBarriers(FBarrierSpawnContext& Context) override;
 	void RemoveTile(FInt32Point Tile) override;
 	void MoveWorldOrigin(int32 TileXOffset, double WorldOffsetX) override;
+	SIZE_T GetTileStorageAllocatedSize() const override;
 
 #if WITH_EDITOR
 	void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
@@ -47,10 +63,17 @@ public:
 
 protected:
 	void BeginPlay() override;
+	void CompactInstances();
 
 	// 每个 tile 上的静态网格体实例编号
-	TMap<FInt32Point, TArray<FInt32Point>> TileInstanceIndices;
+	TTileSlots<TArray<FInt32Point>> TileInstanceIndices;
 
-	// 各个 ISM 中可替换的实例
+	// 各个 ISM 中可替换的实例，这些实例已经被隐藏
 	TArray<TArray<int32>> ReplaceInstanceIndices;
+	FTimerHandle CompactTimerHandle;
+	TMap<int32, int32> CompactRemap; // 压缩时使用的临时数据
+
+	// 各个 ISM 这一帧待提交的实例
+	TArray<FISMInstanceBatch> PendingInstances;
+	TArray<int32> CommittedIndices;
 };
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UInstancedStaticMeshComponent;
+
+// 收集一个 ISM 上这一帧要写入的实例 transform，最后一次性提交
+// 逐个调用 AddInstance/UpdateInstanceTransform 的开销在每个 tile 有几十个实例时占主要部分
+struct FISMInstanceBatch
+{
+	// Transform 为世界坐标
+	void Add(const FTransform& Transform) { Transforms.Add(Transform); }
+	int32 Num() const { return Transforms.Num(); }
+	bool IsEmpty() const { return Transforms.IsEmpty(); }
+	SIZE_T GetAllocatedSize() const
+	{
+		return Transforms.GetAllocatedSize() + RunTransforms.GetAllocatedSize() + ReusedIndices.GetAllocatedSize() + MoveSources.GetAllocatedSize() + RunCustomData.GetAllocatedSize()
+			+ FreeMask.GetAllocatedSize();
+	}
+
+	// 优先复用 FreeIndices 中编号最小的实例，排序后按连续区间 BatchUpdateInstancesTransforms，剩下的用一次 AddInstances 新建
+	// 用到的实例编号追加到 OutIndices，顺序和 Add 的顺序不一定相同。提交之后 batch 被清空
+	void Commit(UInstancedStaticMeshComponent* Component, TArray<int32>& FreeIndices, TArray<int32>& OutIndices);
+
+	// 把 Component 上的所有实例平移 Offset（组件空间），只提交一次
+	static void OffsetAllInstances(UInstancedStaticMeshComponent* Component, const FVector& Offset);
+
+	// 把回收的实例缩放为 0，立即停止渲染，ISM 也会销毁缩放为 0 的实例的 body
+	static void HideInstances(UInstancedStaticMeshComponent* Component, TConstArrayView<int32> InstanceIndices);
+
+	// 把末尾存活的实例移到编号最小的空闲实例上，再删除末尾空闲的实例，FreeIndices 中只留下还没填上的空洞
+	// 最多移动 MaxMoves 个实例，移动的实例按目标编号的连续区间批量更新，返回 false 表示还有空洞需要之后继续
+	// 移动过的实例的 旧编号 -> 新编号 写入 OutRemap，调用者据此更新自己记录的编号
+	bool Compact(UInstancedStaticMeshComponent* Component, TArray<int32>& FreeIndices, int32 MaxMoves, TMap<int32, int32>& OutRemap);
+
+private:
+	TArray<FTransform> Transforms;
+	// 提交时使用的临时数组，保留容量避免每帧分配
+	TArray<FTransform> RunTransforms;
+	TArray<int32> ReusedIndices;
+	// 压缩时使用的临时数据
+	TArray<int32> MoveSources;
+	TArray<float> RunCustomData;
+	TBitArray<> FreeMask;
+};
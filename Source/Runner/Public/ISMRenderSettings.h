@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "ISMRenderSettings.generated.h"
+
+class UInstancedStaticMeshComponent;
+
+// ISM spawner 的渲染设置，每个 spawner 类可以在默认值中单独配置
+USTRUCT(BlueprintType)
+struct FISMRenderSettings
+{
+	GENERATED_BODY()
+
+	// 使用 HISM 按簇剔除，遍历场景和提交绘制的开销只和可见的实例有关，簇树在后台线程重建
+	UPROPERTY(EditAnywhere, Category = "Rendering")
+	bool bUseHierarchicalInstances = false;
+
+	// 实例开始淡出和完全剔除的距离，都为 0 时沿用组件上的设置
+	UPROPERTY(EditAnywhere, Category = "Rendering")
+	int32 StartCullDistance = 0;
+
+	UPROPERTY(EditAnywhere, Category = "Rendering")
+	int32 EndCullDistance = 0;
+
+	bool HasCullDistances() const { return StartCullDistance != 0 || EndCullDistance != 0; }
+
+	// 按设置新建组件，复制 Template 的网格体、材质和碰撞设置，挂在 Owner 的根组件下
+	UInstancedStaticMeshComponent* CreateComponent(AActor* Owner, const UInstancedStaticMeshComponent* Template, EComponentMobility::Type Mobility) const;
+
+	// 在 BeginPlay 中调用，组件的类型不符合设置时换成新建的组件，返回之后使用的组件
+	UInstancedStaticMeshComponent* ApplyTo(AActor* Owner, UInstancedStaticMeshComponent* Component) const;
+};
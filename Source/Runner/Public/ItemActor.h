@@ -6,9 +6,11 @@
 #include "CoinActor.h"
 #include "ItemActor.generated.h"
 
-/**
- * 
- */
+// 上下晃动由材质的 WPO 完成，Amplitude 和 Frequency 通过 custom primitive data 传给材质
+// 材质约定：custom primitive data [BobAmplitudeDataIndex] 为振幅，[BobFrequencyDataIndex] 为角频率（弧度每秒）
+// Z 方向的 WPO 为 Amplitude * sin(Time * Frequency)，被吸引之后振幅为 0
+// 材质读取它们时勾选 bMaterialDrivesMotion，这时 WPO 不移动碰撞体，收集范围固定在 spawn 的位置，不再跟着晃动
+// 否则和以前一样在 tick 中移动 actor，碰撞体跟着晃动
 UCLASS()
 class RUNNER_API AItemActor : public ACoinActor
 {
@@ -16,9 +18,17 @@ class RUNNER_API AItemActor : public ACoinActor
 	
 protected:	
 	void BeginPlay() override;
+	void StartAttract() override;
+	void TickMotion(float DeltaTime) override;
+
+	// 写入材质使用的晃动参数，被吸引时振幅为 0
+	void SetBobAmplitude(float InAmplitude);
 
 public:
-	void Tick(float DeltaTime) override;
+	void OnAcquiredFromPool_Implementation() override;
+
+	static constexpr int32 BobAmplitudeDataIndex = 0;
+	static constexpr int32 BobFrequencyDataIndex = 1;
 
 	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category="Default")
 	float Amplitude = 70.0f;
@@ -26,6 +36,7 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category="Default")
 	float Frequency = 3.0f;
 
+	// tick 中晃动时使用
 	float CurrentTime = 0.0f;
 	double InitialZ = 0.0;
 };
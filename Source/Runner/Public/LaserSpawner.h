@@ -15,9 +15,7 @@ class RUNNER_API ALaserSpawner : public ABPBarrierSpawner
 	GENERATED_BODY()
 
 public:
-
-	void BeginPlay() override;
-	void SpawnBarriers(TArrayView<RandomPoint> Positions, FInt32Point Tile, AWorldGenerator* WorldGenerator) override;
+	bool SpawnBarriers(FBarrierSpawnContext& Context) override;
 
 	UPROPERTY(EditAnywhere, Category = "Laser")
 	int32 OneLineLaserNumber = 2; // 每行激光的数量
@@ -31,4 +29,12 @@ public:
 	UPROPERTY(EditAnywhere)
 	TSubclassOf<class AActor> AnotherLaserClass;
 
+	// 每个 tile 至多一个特殊激光
+	UPROPERTY(EditAnywhere, Category = "Laser")
+	int32 SpecialLaserPoolSize = 4;
+
+protected:
+	int32 GetDefaultPoolSize() const override;
+	void PrewarmPool(class UActorPoolSubsystem& Pool, int32 Count) const override;
+
 };
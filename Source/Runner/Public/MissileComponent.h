@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "Templates/SubclassOf.h"
+#include "TileRandom.h"
 
 #include "MissileComponent.generated.h"
 
@@ -62,6 +63,8 @@ private:
 		double TotalDistance = 0.0; // 总距离
 		double TotalTime = 0.0; // 总时间
 
-		FVector PredictPlayerPos(FVector PlayerPos);
-		FVector RandomMissileStartPos(FVector TargetPos);
+		uint32 RandomCounter = 0; // 每次发射判定使用一个新的随机流，同一个种子下可以复现
+
+		FVector PredictPlayerPos(FVector PlayerPos, FTileRandomStream& Random);
+		FVector RandomMissileStartPos(FVector TargetPos, FTileRandomStream& Random);
 };
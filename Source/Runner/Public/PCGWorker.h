@@ -1,28 +1,55 @@
+#pragma once
+
 #include "Containers/Array.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/PlatformAffinity.h"
 #include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
 #include "Math/MathFwd.h"
+#include "Templates/Function.h"
+#include "Templates/SharedPointer.h"
+
+class FEvent;
+class FRunnableThread;
+struct FWorldGenConfig;
 
+// game 线程提交给生成线程的请求，结果写入 AWorldGenerator 中对应 slot 的 TaskBuffer
+struct FPCGRequest
+{
+  int32 BufferIndex = INDEX_NONE;
+  FInt32Point Tile = FInt32Point::ZeroValue;
+  FVector2D PositionOffset = FVector2D::ZeroVector;
+  int32 Difficulty = 0;
+  int64 Seed = 0;
+  FInt32Point RandomTile = FInt32Point::ZeroValue; // 移动原点之前的绝对 tile 编号，用于随机数
+  TSharedPtr<const FWorldGenConfig> Config;        // 派发时的生成参数快照
+};
+
+// 常驻的 world generation 线程，只由 game 线程提交请求，只由自己消费，因此请求队列是单生产者单消费者的环形队列
 class FPCGWorker : public FRunnable
 {
 public:
-  FPCGWorker(int32 InMaxPointsInCell, int32 InMinPointsInCell, int32 InXCellNumber, int32 InYCellNumber)
-    : MaxPointsInCell(InMaxPointsInCell), MinPointsInCell(InMinPointsInCell), XCellNumber(InXCellNumber), YCellNumber(InYCellNumber)
-  {
-    Heights[0].SetNumUninitialized(XCellNumber * YCellNumber);
-    Heights[1].SetNumUninitialized(XCellNumber * YCellNumber);
-    Points[0].SetNumUninitialized(XCellNumber * YCellNumber);
-    Points[1].SetNumUninitialized(XCellNumber * YCellNumber);
-  }
-
-  int32 MaxPointsInCell;
-  int32 MinPointsInCell;
-  int32 XCellNumber;
-  int32 YCellNumber;
-
-  int32 ReadIndex = 0;
-  
-  TArray<double> Heights[2];
-	TArray<FVector2D> Points[2];
-
-	uint32 Run() override;
-};
\ No newline at end of file
+  using FExecutor = TFunction<void(const FPCGRequest&)>;
+
+  FPCGWorker(FExecutor InExecutor, uint32 InQueueCapacity);
+  ~FPCGWorker() override;
+
+  // 创建线程，AffinityMask 为 0 时不设置亲和性
+  bool Start(const TCHAR* ThreadName, EThreadPriority Priority, uint64 AffinityMask);
+
+  // 仅允许 game 线程调用
+  bool Submit(const FPCGRequest& Request);
+
+  // 仅允许 game 线程调用。等待正在执行的请求完成并结束线程，队列中还没有执行的请求交给 OnDropped
+  void Shutdown(TFunctionRef<void(const FPCGRequest&)> OnDropped);
+
+  uint32 Run() override;
+  void Stop() override;
+
+private:
+  FExecutor Executor;
+  TCircularQueue<FPCGRequest> Requests;
+  FEvent* WorkEvent = nullptr;
+  FRunnableThread* Thread = nullptr;
+  FThreadSafeBool bStopRequested = false;
+};
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "ReusableActor.generated.h"
+
+UINTERFACE(MinimalAPI, BlueprintType)
+class UReusableActor : public UInterface
+{
+	GENERATED_BODY()
+};
+
+// 由 UActorPoolSubsystem 复用的 actor，BeginPlay 只会执行一次，每次复用时的初始化放在这里
+class RUNNER_API IReusableActor
+{
+	GENERATED_BODY()
+
+public:
+	// 从池中取出并放到新的位置之后调用，此时 tick、碰撞和可见性已经恢复成类的默认值
+	UFUNCTION(BlueprintNativeEvent, Category = "Actor Pool")
+	void OnAcquiredFromPool();
+	virtual void OnAcquiredFromPool_Implementation() {}
+
+	// 放回池中、预热或者被 Park 时调用，Park 之后再放回池中时会调用两次，实现需要允许重复调用
+	UFUNCTION(BlueprintNativeEvent, Category = "Actor Pool")
+	void OnReturnedToPool();
+	virtual void OnReturnedToPool_Implementation() {}
+};
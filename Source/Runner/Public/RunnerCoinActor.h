@@ -6,16 +6,23 @@
 #include "CoinActor.h"
 #include "RunnerCoinActor.generated.h"
 
-/**
- * 
- */
+// 旋转由材质的 WPO 完成，SpinSpeed 通过 custom primitive data 传给材质
+// 材质约定：custom primitive data [SpinSpeedDataIndex] 为绕本地 Z 轴每秒旋转的角度
+// 材质读取它时勾选 bMaterialDrivesMotion，否则和以前一样在 tick 中旋转 actor
+// 作为 AGoldCoinSpawner 的 BarrierClass 时只是模板，UCoinFieldComponent 从默认对象读取 SpinSpeed 和 bMaterialDrivesMotion
 UCLASS()
 class RUNNER_API ARunnerCoinActor : public ACoinActor
 {
 	GENERATED_BODY()
 public:	
 	ARunnerCoinActor();
-	
+
+	static constexpr int32 SpinSpeedDataIndex = 0;
+
+	UPROPERTY(EditAnywhere, Category = "Default")
+	float SpinSpeed = 300.0f; // 每秒旋转的角度
+
 protected:
-	void Tick(float DeltaTime) override;
+	void BeginPlay() override;
+	void TickMotion(float DeltaTime) override;
 };
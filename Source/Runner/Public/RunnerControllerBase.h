@@ -25,4 +25,8 @@ public:
 	void StartCountDown();
 
 	FRotator GetControlRotation() const override;
+
+private:
+	// 倒计时结束时起始区域还没有生成完，等待 AWorldGenerator::OnWorldReady 后再开始
+	FDelegateHandle WorldReadyHandle;
 };
@@ -316,6 +316,7 @@ public:
 
 private:
 	mutable FHitResult OldHit;
+	uint32 OldHitRemapSerial = 0; // 记录 OldHit 时 spawner 的实例编号版本，压缩之后 OldHit.Item 失效
 
 	UPROPERTY()
 	TObjectPtr<class USkeletalMeshComponent> SkateboardMesh;
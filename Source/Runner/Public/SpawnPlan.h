@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// 金币轨迹的参数快照，由 AGoldCoinSpawner 填写，worker 只读取这里的值
+struct FCoinTrajectoryParams
+{
+	// 玩家的运动参数，和 URunnerMovementComponent 一致
+	double MaxWalkingSpeed = 500.0;
+	double ZVelocityInAir = -300.0;
+	double Gravity = 980.0;
+	double TakeoffSpeedScale = 1.0;
+	double MaxStartZVelocityInAir = 1000.0;
+
+	double SpawnTimeInterval = 0.1;
+	int32 MaxCoinNumber = 30;
+	double GroundClearance = 10.0;						// 金币离地面的最小距离
+	FVector StartOffset = FVector::ZeroVector; // 相对起跳点的偏移
+	double MinTakeoffAcceleration = 1000.0;		// 地面曲率产生的向心加速度超过该值时可以起飞
+};
+
+enum class EAlignMode : uint8; // 定义在 BarrierSpawner.h
+
+// ABarrierSpawner::GetTransformFromSeed 的参数快照，worker 按同样的规则计算 transform
+struct FSpawnTransformParams
+{
+	EAlignMode AlignMode{};
+	double BarrierOffset = 0.0;
+	double BarrierRadius = 10.0;
+	// GetRotationFromSeed 写成线性的形式：BaseRotation + SeedRotationScale * Seed（逐分量）
+	FRotator BaseRotation = FRotator::ZeroRotator;
+	FRotator SeedRotationScale = FRotator(0.0, 360.0, 0.0);
+	bool bAffineRotation = true; // false 时 GetRotationFromSeed 不是一次函数，只能在 game 线程上调用它
+	double MaxPitch = TNumericLimits<double>::Max(); // 对齐之后俯仰角的上限
+};
+
+// 簇布局的参数快照，由 AISMClusterSpawner 填写
+struct FClusterLayoutParams
+{
+	int32 MinMeshCount = 1;
+	int32 MaxMeshCount = 5;
+	double MinDistance = 50.0;
+	double HalfExtent = 100.0;
+	int32 TryTimes = 10;
+	int32 MeshNumber = 0; // 可选的网格体数量
+};
+
+struct FPlannedInstance
+{
+	FTransform Transform; // 相对规划时的世界原点
+	int32 MeshIndex = 0;
+};
+
+// worker 阶段为 spawner 预先计算好的结果，game 线程只需要按结果创建物体
+struct FSpawnPlan
+{
+	FVector2D AnchorUV = FVector2D(-1.0, -1.0); // 没有找到合适的位置时为负
+	TArray<FVector> Positions;									// 相对规划时的世界原点
+	double OriginOffsetX = 0.0;									// 规划时的 WorldOriginOffset.X
+
+	// 每个采样点对齐之后的 transform，相对规划时的世界原点
+	TArray<FTransform> PointTransforms;
+
+	// 每个采样点生成的实例，第 i 个点对应 Instances 中 [InstanceStarts[i], InstanceStarts[i + 1]) 的部分
+	TArray<FPlannedInstance> Instances;
+	TArray<int32> InstanceStarts;
+
+	bool IsValid() const { return AnchorUV.X >= 0.0 && AnchorUV.Y >= 0.0; }
+	bool HasInstances(int32 PointNumber) const { return InstanceStarts.Num() == PointNumber + 1; }
+	TConstArrayView<FPlannedInstance> GetInstances(int32 PointIndex) const
+	{
+		return TConstArrayView<FPlannedInstance>(Instances).Slice(InstanceStarts[PointIndex], InstanceStarts[PointIndex + 1] - InstanceStarts[PointIndex]);
+	}
+	void Reset()
+	{
+		AnchorUV = FVector2D(-1.0, -1.0);
+		Positions.Reset();
+		OriginOffsetX = 0.0;
+		PointTransforms.Reset();
+		Instances.Reset();
+		InstanceStarts.Reset();
+	}
+	// 复用自己已有的容量复制 Other，不使用 TArray 的赋值，后者在容量不同时可能重新分配
+	void CopyFrom(const FSpawnPlan& Other)
+	{
+		AnchorUV = Other.AnchorUV;
+		OriginOffsetX = Other.OriginOffsetX;
+		Positions.Reset();
+		Positions.Append(Other.Positions);
+		PointTransforms.Reset();
+		PointTransforms.Append(Other.PointTransforms);
+		Instances.Reset();
+		Instances.Append(Other.Instances);
+		InstanceStarts.Reset();
+		InstanceStarts.Append(Other.InstanceStarts);
+	}
+	SIZE_T GetAllocatedSize() const
+	{
+		return Positions.GetAllocatedSize() + PointTransforms.GetAllocatedSize() + Instances.GetAllocatedSize() + InstanceStarts.GetAllocatedSize();
+	}
+	// 规划之后世界原点可能移动过，换算到当前的原点下
+	FVector GetOriginShift(double CurrentOriginOffsetX) const
+	{
+		return FVector(OriginOffsetX - CurrentOriginOffsetX, 0.0, 0.0);
+	}
+};
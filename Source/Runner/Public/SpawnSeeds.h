@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// 单个障碍物的生成种子，只在使用时从 SoA 中解出来，不会被存储
+struct RandomPoint
+{
+	FVector2D UVPos;	 // 0 - 1 的随机变量表示点的坐标
+	FRotator Rotation; // 0 - 1 的随机变量表示点的旋转
+};
+
+// 旋转种子只是 [0, 1) 的随机数，量化到 16 位就足够了（Yaw 的精度约 0.005 度）
+namespace SpawnSeed
+{
+	FORCEINLINE uint16 Quantize(double Value)
+	{
+		return uint16(FMath::Clamp(Value * 65536.0, 0.0, 65535.0));
+	}
+	FORCEINLINE double Dequantize(uint16 Value)
+	{
+		return (double(Value) + 0.5) / 65536.0;
+	}
+} // namespace SpawnSeed
+
+// 一段种子的 SoA 视图，按 spawner 切片后传给 spawner
+struct FSpawnSeedView
+{
+	TArrayView<FVector2f> UV;
+	TArrayView<uint16> Yaw;
+	TArrayView<uint16> Pitch;
+	TArrayView<uint16> Roll;
+
+	int32 Num() const { return UV.Num(); }
+	bool IsEmpty() const { return UV.IsEmpty(); }
+
+	FVector2D GetUV(int32 Index) const { return FVector2D(UV[Index]); }
+	FRotator GetRotation(int32 Index) const
+	{
+		return FRotator(SpawnSeed::Dequantize(Pitch[Index]), SpawnSeed::Dequantize(Yaw[Index]), SpawnSeed::Dequantize(Roll[Index]));
+	}
+	RandomPoint operator[](int32 Index) const
+	{
+		return RandomPoint{ GetUV(Index), GetRotation(Index) };
+	}
+
+	FSpawnSeedView Slice(int32 Index, int32 Count) const
+	{
+		return FSpawnSeedView{ UV.Slice(Index, Count), Yaw.Slice(Index, Count), Pitch.Slice(Index, Count), Roll.Slice(Index, Count) };
+	}
+};
+
+// 一个 tile 所有 spawner 的种子，按 spawner 的顺序连续存放
+// 每个点 14 字节（float UV + 3 个 16 位种子），原来 AoS 的 RandomPoint 是 64 字节
+template <typename AllocatorType = FDefaultAllocator>
+struct TSpawnSeedBuffer
+{
+	TArray<FVector2f, AllocatorType> UV;
+	TArray<uint16, AllocatorType> Yaw;
+	TArray<uint16, AllocatorType> Pitch;
+	TArray<uint16, AllocatorType> Roll;
+
+	TSpawnSeedBuffer() = default;
+	explicit TSpawnSeedBuffer(const FSpawnSeedView& View)
+			: UV(View.UV), Yaw(View.Yaw), Pitch(View.Pitch), Roll(View.Roll)
+	{
+	}
+
+	int32 Num() const { return UV.Num(); }
+
+	// 复用已有的容量复制 View 中的种子
+	void CopyFrom(const FSpawnSeedView& View)
+	{
+		UV.Reset();
+		UV.Append(View.UV);
+		Yaw.Reset();
+		Yaw.Append(View.Yaw);
+		Pitch.Reset();
+		Pitch.Append(View.Pitch);
+		Roll.Reset();
+		Roll.Append(View.Roll);
+	}
+	SIZE_T GetAllocatedSize() const
+	{
+		return UV.GetAllocatedSize() + Yaw.GetAllocatedSize() + Pitch.GetAllocatedSize() + Roll.GetAllocatedSize();
+	}
+
+	void SetNumUninitialized(int32 NewNum)
+	{
+		UV.SetNumUninitialized(NewNum, EAllowShrinking::No);
+		Yaw.SetNumUninitialized(NewNum, EAllowShrinking::No);
+		Pitch.SetNumUninitialized(NewNum, EAllowShrinking::No);
+		Roll.SetNumUninitialized(NewNum, EAllowShrinking::No);
+	}
+
+	void Set(int32 Index, FVector2D UVPos, double InYaw, double InPitch, double InRoll)
+	{
+		UV[Index] = FVector2f(UVPos);
+		Yaw[Index] = SpawnSeed::Quantize(InYaw);
+		Pitch[Index] = SpawnSeed::Quantize(InPitch);
+		Roll[Index] = SpawnSeed::Quantize(InRoll);
+	}
+
+	FSpawnSeedView View()
+	{
+		return FSpawnSeedView{ UV, Yaw, Pitch, Roll };
+	}
+	FSpawnSeedView Slice(int32 Index, int32 Count)
+	{
+		return View().Slice(Index, Count);
+	}
+};
+
+// slot 中的种子，跨 tile 复用，不会收缩
+using FSpawnSeedBuffer = TSpawnSeedBuffer<>;
+// 延迟 spawn 缓存的种子，只有少量的点（金币每个 tile 2 个），内联存储避免每个 tile 一次堆分配
+using FCachedSpawnSeeds = TSpawnSeedBuffer<TInlineAllocator<4>>;
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CoinTrajectory.h"
+#include "SpawnPlan.h"
+#include "SpawnSeeds.h"
+
+struct FTileRandomStream;
+
+// 在 worker 上计算障碍物的 transform，只读取快照和高度图，可以在任意线程中使用
+namespace SpawnTransform
+{
+	// 和 ABarrierSpawner::GetTransformFromSeed 一致，位置相对 Config 对应的世界原点
+	FTransform FromSeed(const FWorldGenConfig& Config, const FSpawnTransformParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, const RandomPoint& Seed);
+	// Rotation 为 GetRotationFromSeed 的结果，用于不满足一次函数的 spawner
+	FTransform FromSeed(const FWorldGenConfig& Config, const FSpawnTransformParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, const RandomPoint& Seed, FRotator Rotation);
+	// 一个 spawner 在 tile 上所有点的 transform，结果一次性写入 OutTransforms
+	void FromSeeds(const FWorldGenConfig& Config, const FSpawnTransformParams& Params, const FTerrainHeightSampler& Sampler, FInt32Point Tile, FSpawnSeedView Seeds, TArray<FTransform>& OutTransforms);
+
+	// 以 Seed 为中心拒绝采样出一个簇，并为每个成员选择网格体，结果追加到 OutInstances
+	void PlanCluster(const FWorldGenConfig& Config, const FSpawnTransformParams& Params, const FClusterLayoutParams& Layout, const FTerrainHeightSampler& Sampler, FInt32Point Tile, const RandomPoint& Seed, FTileRandomStream& Random, TArray<FPlannedInstance>& OutInstances);
+} // namespace SpawnTransform
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// 从 FTileArena 中分配的定长数组，容量在创建时确定，不会再访问堆
+// 只用于平凡类型，析构时不会调用元素的析构函数
+template <class T>
+class TArenaArray
+{
+	static_assert(TIsTriviallyDestructible<T>::Value, "TArenaArray only supports trivially destructible types");
+
+public:
+	TArenaArray() = default;
+	TArenaArray(T* InData, int32 InCapacity)
+			: Data(InData)
+			, Capacity(InCapacity)
+	{
+	}
+
+	int32 Num() const { return ArrayNum; }
+	int32 Max() const { return Capacity; }
+	bool IsEmpty() const { return ArrayNum == 0; }
+	T* GetData() const { return Data; }
+
+	T& operator[](int32 Index) const
+	{
+		checkSlow(Index >= 0 && Index < ArrayNum);
+		return Data[Index];
+	}
+
+	int32 Add(const T& Item)
+	{
+		check(ArrayNum < Capacity);
+		Data[ArrayNum] = Item;
+		return ArrayNum++;
+	}
+	void SetNumUninitialized(int32 NewNum, EAllowShrinking = EAllowShrinking::No)
+	{
+		check(NewNum >= 0 && NewNum <= Capacity);
+		ArrayNum = NewNum;
+	}
+	void SetNum(int32 NewNum, EAllowShrinking AllowShrinking = EAllowShrinking::No)
+	{
+		auto OldNum = ArrayNum;
+		SetNumUninitialized(NewNum, AllowShrinking);
+		for (int32 i = OldNum; i < NewNum; ++i)
+		{
+			Data[i] = T();
+		}
+	}
+	// 顺序无关紧要时用末尾元素填补
+	void RemoveAtSwap(int32 Index, int32 Count = 1, EAllowShrinking = EAllowShrinking::No)
+	{
+		check(Index >= 0 && Count >= 0 && Index + Count <= ArrayNum);
+		for (int32 i = 0; i < Count; ++i)
+		{
+			Data[Index + i] = Data[ArrayNum - 1 - i];
+		}
+		ArrayNum -= Count;
+	}
+
+	T* begin() const { return Data; }
+	T* end() const { return Data + ArrayNum; }
+
+private:
+	T* Data = nullptr;
+	int32 Capacity = 0;
+	int32 ArrayNum = 0;
+};
+
+// 线性内存分配器，每个 slot 持有一个，worker 阶段的临时数据都从这里分配，slot 释放时整体重置
+// 同一时刻只允许一个线程使用
+class FTileArena
+{
+public:
+	FTileArena() = default;
+	~FTileArena();
+	FTileArena(const FTileArena&) = delete;
+	FTileArena& operator=(const FTileArena&) = delete;
+
+	void* Allocate(SIZE_T Size, SIZE_T Alignment);
+
+	template <class T>
+	TArrayView<T> AllocateUninitialized(int32 Num)
+	{
+		return TArrayView<T>(static_cast<T*>(Allocate(Num * sizeof(T), alignof(T))), Num);
+	}
+	template <class T>
+	TArenaArray<T> MakeArray(int32 Capacity)
+	{
+		return TArenaArray<T>(static_cast<T*>(Allocate(Capacity * sizeof(T), alignof(T))), Capacity);
+	}
+
+	// 释放本轮分配的所有内存，如果本轮发生过溢出，把主内存块扩大到本轮的用量，之后的 tile 不再访问堆
+	void Reset();
+
+	// 自上次调用以来向堆申请内存的次数
+	uint32 ConsumeHeapAllocationCount() { return Exchange(HeapAllocationCount, 0); }
+	SIZE_T GetCapacity() const { return Capacity; }
+
+private:
+	// 主内存块放不下时单独向堆申请的内存，用链表串起来，Reset 时释放
+	struct FOverflowChunk
+	{
+		FOverflowChunk* Next;
+	};
+
+	uint8* Block = nullptr;
+	SIZE_T Capacity = 0;
+	SIZE_T Offset = 0;
+
+	FOverflowChunk* OverflowChunks = nullptr;
+	SIZE_T OverflowBytes = 0;
+
+	uint32 HeapAllocationCount = 0;
+};
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TileSlots.h"
+
+// tile UV 空间中的禁止生成区域，CanSpawnThisBarrier 只需要查一次位图
+// 位图是保守的（格子和区域有重叠就置位），命中后再用精确的区域判断，所以结果和逐个比较一致
+struct FTileExclusionIndex
+{
+	static constexpr int32 Resolution = 32; // 每个 tile 每个方向 32 个格子，一行正好是一个 uint32
+
+	// 以 Center 为中心的方形区域，边界算在区域内
+	void AddBox(FInt32Point Tile, FVector2D Center, double HalfExtent);
+	// X 方向上的一条带，对整列 tile 生效，边界不算在区域内，超出 tile 的部分会写到相邻的列
+	void AddBandX(FInt32Point Tile, double CenterU, double HalfWidth);
+
+	bool IsExcluded(FInt32Point Tile, FVector2D UV) const;
+
+	// 移除 tile 上的区域，以及这一列 tile 产生的带
+	void RemoveTile(FInt32Point Tile);
+	void MoveWorldOrigin(int32 TileXOffset);
+	void Reset();
+	SIZE_T GetAllocatedSize() const { return TileBoxes.GetAllocatedSize() + ColumnBands.GetAllocatedSize(); }
+
+private:
+	struct FTileBoxes
+	{
+		uint32 Rows[Resolution] = {}; // Rows[v] 的第 u 位
+		TArray<FBox2D, TInlineAllocator<2>> Boxes;
+
+		friend void ResetTileSlotValue(FTileBoxes& Value)
+		{
+			FMemory::Memzero(Value.Rows);
+			Value.Boxes.Reset();
+		}
+		friend SIZE_T GetTileSlotValueAllocatedSize(const FTileBoxes& Value) { return Value.Boxes.GetAllocatedSize(); }
+	};
+	struct FBand
+	{
+		int32 OwnerX; // 产生这条带的 tile 列（绝对编号），随这一列一起移除
+		double MinU;	// 开区间
+		double MaxU;
+	};
+	struct FColumnBands
+	{
+		uint32 Mask = 0;
+		TArray<FBand, TInlineAllocator<2>> Bands;
+
+		friend void ResetTileSlotValue(FColumnBands& Value)
+		{
+			Value.Mask = 0;
+			Value.Bands.Reset();
+		}
+		friend SIZE_T GetTileSlotValueAllocatedSize(const FColumnBands& Value) { return Value.Bands.GetAllocatedSize(); }
+	};
+
+	static int32 ToCell(double Value)
+	{
+		return FMath::Clamp(FMath::FloorToInt32(Value * Resolution), 0, Resolution - 1);
+	}
+	// [Min, Max] 与 [0, 1] 相交部分覆盖的格子
+	static uint32 CellMask(double Min, double Max);
+	void AddBandToColumn(int32 ColumnX, int32 OwnerX, double MinU, double MaxU);
+
+	TTileSlots<FTileBoxes> TileBoxes;
+	TTileSlots<FColumnBands> ColumnBands{16, 1}; // 按列存放，Y 固定为 0
+};
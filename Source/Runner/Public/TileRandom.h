@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// 随机流的用途，和 (Seed, Tile, SubStream) 一起决定一个随机流，不同用途的随机数互不影响
+enum class ETileRandomStream : uint32
+{
+	BarrierCount,			// 每个 spawner 的障碍物数量，Index 为 spawner 下标
+	UngroupedPoints,	// 不参与泊松采样的 spawner，SubStream 为 spawner 下标
+	GroupSampling,		// 分组采样，SubStream 为组号
+	GroupSeeds,				// 分组中每个点的旋转种子，SubStream 为组号
+	PointSetLibrary,	// 预计算点集，SubStream 为 组号 * 点集数量 + 点集下标
+	Cluster,					// ISMClusterSpawner 的簇布局，SubStream 为 spawner 下标 << 16 | 点下标
+	Missile,					// 导弹，SubStream 为发射判定的计数
+};
+
+// 基于计数器的随机数（SplitMix64），第 Index 个样本只由 (Seed, Tile, Stream, SubStream, Index) 决定
+// 不需要保存引擎状态，任意线程都可以并行地、随机访问地计算任意样本，同一个种子的结果完全可复现
+struct FTileRandomStream
+{
+	using result_type = uint64;
+
+	FTileRandomStream(uint64 Seed, FInt32Point Tile, ETileRandomStream Stream, uint32 SubStream = 0)
+	{
+		auto TileBits = (uint64(uint32(Tile.X)) << 32) | uint64(uint32(Tile.Y));
+		auto StreamBits = (uint64(Stream) << 32) | uint64(SubStream);
+		Key = Mix(Mix(Mix(Seed) ^ TileBits) ^ StreamBits);
+	}
+
+	// 随机访问第 Index 个样本
+	uint64 At(uint32 Index) const
+	{
+		return Mix(Key + (uint64(Index) + 1) * 0x9E3779B97F4A7C15ull);
+	}
+	double UnitAt(uint32 Index) const
+	{
+		return ToUnit(At(Index));
+	}
+
+	// 顺序读取，内部只是一个递增的计数器
+	uint64 Next()
+	{
+		return At(Counter++);
+	}
+	// [0, 1)
+	double NextUnit()
+	{
+		return ToUnit(Next());
+	}
+	// [Min, Max)
+	double NextRange(double Min, double Max)
+	{
+		return Min + (Max - Min) * NextUnit();
+	}
+	// [Min, Max]，和 FMath::RandRange 一致
+	int32 NextIntRange(int32 Min, int32 Max)
+	{
+		auto Range = int64(Max) - int64(Min) + 1;
+		return Range > 0 ? Min + int32(FMath::Min(int64(NextUnit() * Range), Range - 1)) : Min;
+	}
+
+	// 满足 UniformRandomBitGenerator，可以直接用于 std::shuffle
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return MAX_uint64; }
+	result_type operator()() { return Next(); }
+
+	uint32 GetCounter() const { return Counter; }
+
+private:
+	static uint64 Mix(uint64 X)
+	{
+		X = (X ^ (X >> 30)) * 0xBF58476D1CE4E5B9ull;
+		X = (X ^ (X >> 27)) * 0x94D049BB133111EBull;
+		return X ^ (X >> 31);
+	}
+	static double ToUnit(uint64 Bits)
+	{
+		return double(Bits >> 11) * (1.0 / 9007199254740992.0); // 2^53
+	}
+
+	uint64 Key = 0;
+	uint32 Counter = 0;
+};
@@ -0,0 +1,204 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// 移除 tile 时重置槽位中的值。TArray 只清空元素并保留容量，之后落到这个槽位的 tile 复用这块内存
+// 其它持有容器的值类型可以提供同名的重载（例如友元函数）
+template <class T>
+void ResetTileSlotValue(T& Value)
+{
+	Value = T();
+}
+template <class ElementType, class AllocatorType>
+void ResetTileSlotValue(TArray<ElementType, AllocatorType>& Value)
+{
+	Value.Reset();
+}
+
+// 值类型在堆上持有的内存，用于统计稳态下是否还有分配
+template <class T>
+SIZE_T GetTileSlotValueAllocatedSize(const T& Value)
+{
+	return 0;
+}
+template <class ElementType, class AllocatorType>
+SIZE_T GetTileSlotValueAllocatedSize(const TArray<ElementType, AllocatorType>& Value)
+{
+	return Value.GetAllocatedSize();
+}
+
+// 按 tile 存放数据的容器，内部使用绝对 tile 编号，移动世界原点时只需要修改 OriginTileX，不需要重新插入
+// 槽位排成覆盖流式窗口的环：下标直接由绝对坐标取模得到，查找不需要哈希
+// 两个存活的 tile 落到同一个槽位时把环扩大一倍，窗口稳定之后不再分配内存
+template <class T>
+class TTileSlots
+{
+public:
+	explicit TTileSlots(int32 InSizeX = 16, int32 InSizeY = 4)
+	{
+		check(FMath::IsPowerOfTwo(InSizeX) && FMath::IsPowerOfTwo(InSizeY));
+		SizeX = InSizeX;
+		SizeY = InSizeY;
+	}
+
+	// 参数中的 tile 都是当前原点下的 tile 编号
+	T* Find(FInt32Point Tile)
+	{
+		return const_cast<T*>(static_cast<const TTileSlots*>(this)->Find(Tile));
+	}
+	const T* Find(FInt32Point Tile) const
+	{
+		if (Slots.IsEmpty())
+		{
+			return nullptr;
+		}
+		auto AbsoluteTile = ToAbsolute(Tile);
+		const auto& Slot = Slots[GetSlotIndex(AbsoluteTile)];
+		return Slot.bUsed && Slot.Tile == AbsoluteTile ? &Slot.Value : nullptr;
+	}
+	bool Contains(FInt32Point Tile) const { return Find(Tile) != nullptr; }
+
+	T& FindOrAdd(FInt32Point Tile)
+	{
+		auto AbsoluteTile = ToAbsolute(Tile);
+		if (Slots.IsEmpty())
+		{
+			Slots.SetNum(SizeX * SizeY);
+		}
+		while (true)
+		{
+			auto& Slot = Slots[GetSlotIndex(AbsoluteTile)];
+			if (!Slot.bUsed)
+			{
+				Slot.bUsed = true;
+				Slot.Tile = AbsoluteTile;
+				++NumUsed;
+				return Slot.Value;
+			}
+			if (Slot.Tile == AbsoluteTile)
+			{
+				return Slot.Value;
+			}
+			// 和窗口中的另一个 tile 冲突，扩大冲突的那个方向
+			Grow(Slot.Tile.X != AbsoluteTile.X, Slot.Tile.Y != AbsoluteTile.Y);
+		}
+	}
+
+	// 移除 tile 上的数据，返回是否存在
+	bool Remove(FInt32Point Tile)
+	{
+		auto* Value = Find(Tile);
+		if (!Value)
+		{
+			return false;
+		}
+		auto& Slot = Slots[GetSlotIndex(ToAbsolute(Tile))];
+		Slot.bUsed = false;
+		ResetTileSlotValue(Slot.Value);
+		--NumUsed;
+		return true;
+	}
+	// 值被移出槽位，槽位之前持有的内存也一起移出，频繁调用的路径应当用 Find + Remove
+	bool RemoveAndCopyValue(FInt32Point Tile, T& OutValue)
+	{
+		auto* Value = Find(Tile);
+		if (!Value)
+		{
+			return false;
+		}
+		OutValue = MoveTemp(*Value);
+		return Remove(Tile);
+	}
+
+	// 原点沿 X 轴移动了 TileXOffset 个 tile，之后的 tile 编号都减去 TileXOffset
+	void MoveWorldOrigin(int32 TileXOffset) { OriginTileX += TileXOffset; }
+	// 值中需要引用其它 tile 时存放绝对编号，移动原点时不需要修改
+	FInt32Point ToAbsolute(FInt32Point Tile) const { return FInt32Point(Tile.X + OriginTileX, Tile.Y); }
+
+	int32 Num() const { return NumUsed; }
+	bool IsEmpty() const { return NumUsed == 0; }
+
+	// 环和所有槽位中的值在堆上持有的内存，空闲槽位保留的容量也计算在内
+	SIZE_T GetAllocatedSize() const
+	{
+		auto Size = Slots.GetAllocatedSize();
+		for (const auto& Slot : Slots)
+		{
+			Size += GetTileSlotValueAllocatedSize(Slot.Value);
+		}
+		return Size;
+	}
+
+	void Reset()
+	{
+		for (auto& Slot : Slots)
+		{
+			Slot.bUsed = false;
+			Slot.Value = T();
+		}
+		NumUsed = 0;
+	}
+
+	// Func(FInt32Point Tile, T& Value)，tile 为当前原点下的编号，顺序不确定
+	template <class FuncType>
+	void ForEach(FuncType&& Func)
+	{
+		for (auto& Slot : Slots)
+		{
+			if (Slot.bUsed)
+			{
+				Func(FInt32Point(Slot.Tile.X - OriginTileX, Slot.Tile.Y), Slot.Value);
+			}
+		}
+	}
+	template <class FuncType>
+	void ForEach(FuncType&& Func) const
+	{
+		for (const auto& Slot : Slots)
+		{
+			if (Slot.bUsed)
+			{
+				Func(FInt32Point(Slot.Tile.X - OriginTileX, Slot.Tile.Y), Slot.Value);
+			}
+		}
+	}
+
+private:
+	struct FSlot
+	{
+		FInt32Point Tile; // 绝对 tile 编号
+		bool bUsed = false;
+		T Value;
+	};
+
+	int32 GetSlotIndex(FInt32Point AbsoluteTile) const
+	{
+		return (AbsoluteTile.X & (SizeX - 1)) * SizeY + (AbsoluteTile.Y & (SizeY - 1));
+	}
+
+	void Grow(bool bGrowX, bool bGrowY)
+	{
+		TArray<FSlot> OldSlots = MoveTemp(Slots);
+		SizeX *= bGrowX ? 2 : 1;
+		SizeY *= bGrowY ? 2 : 1;
+		// 存活的 tile 应当都在流式窗口内，环变得很大说明有 tile 没有被移除
+		ensureMsgf(SizeX * SizeY <= 4096, TEXT("TTileSlots grew to %d x %d, are tiles being leaked?"), SizeX, SizeY);
+		Slots.SetNum(SizeX * SizeY);
+		for (auto& Slot : OldSlots)
+		{
+			if (Slot.bUsed)
+			{
+				// 扩大之后原来不冲突的 tile 仍然不冲突
+				Slots[GetSlotIndex(Slot.Tile)] = MoveTemp(Slot);
+			}
+		}
+	}
+
+	TArray<FSlot> Slots;
+	int32 SizeX = 16;
+	int32 SizeY = 4;
+	int32 OriginTileX = 0;
+	int32 NumUsed = 0;
+};
@@ -4,10 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "ReusableActor.h"
 #include "WheelLaser.generated.h"
 
+// 旋转由 UWheelLaserSubsystem 统一处理，actor 本身不 tick
 UCLASS()
-class RUNNER_API AWheelLaser : public AActor
+class RUNNER_API AWheelLaser : public AActor, public IReusableActor
 {
 	GENERATED_BODY()
 
@@ -18,6 +20,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	UPROPERTY(EditAnywhere, Category = "Laser")
@@ -47,8 +50,9 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Laser")
 	FRotator InitialRotation = FRotator::ZeroRotator;
 
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	// 放在对象池中时不需要旋转
+	void OnAcquiredFromPool_Implementation() override;
+	void OnReturnedToPool_Implementation() override;
 
 	void OnConstruction(const FTransform& Transform) override;
 };
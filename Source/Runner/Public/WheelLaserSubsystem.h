@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WheelLaserSubsystem.generated.h"
+
+class AWheelLaser;
+
+// 统一旋转所有的轮状激光，代替每个激光自己的 tick
+// 激光的碰撞会影响玩家，所以旋转仍然通过组件的 transform 完成，只是省掉了逐个 actor tick 的开销
+UCLASS()
+class RUNNER_API UWheelLaserSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void Register(AWheelLaser* Laser);
+	void Unregister(AWheelLaser* Laser);
+
+	void Tick(float DeltaTime) override;
+	TStatId GetStatId() const override;
+
+protected:
+	bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	TArray<TWeakObjectPtr<AWheelLaser>> Lasers;
+};
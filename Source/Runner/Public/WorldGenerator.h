@@ -3,22 +3,66 @@
 #pragma once
 
 #include "Containers/Map.h"
+#include "Containers/ResizableCircularQueue.h"
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "HAL/Platform.h"
 #include "Math/MathFwd.h"
+#include "PCGWorker.h"
 #include "ProceduralMeshComponent.h"
-#include <random>
+#include "SpawnPlan.h"
+#include "SpawnSeeds.h"
+#include "TileArena.h"
+#include "Tasks/Task.h"
+#include "TileExclusion.h"
+#include "TileRandom.h"
+#include "TileSlots.h"
 #include "Templates/SubclassOf.h"
 #include "WorldGenerator.generated.h"
 
 DECLARE_MULTICAST_DELEGATE_OneParam(FOnWorldOriginChanged, double);
+DECLARE_MULTICAST_DELEGATE(FOnWorldReady);
 
-struct RandomPoint
+struct FSpawnBudget;
+
+// tile 生成流水线中的各个阶段
+enum class ETileStage : uint8
+{
+	Heights,		// 高度图和 UV，worker 线程
+	Normals,		// 法线和切线，worker 线程
+	Points,			// 障碍物撒点，worker 线程
+	Plans,			// 为 spawner 预先规划，worker 线程
+	GroundMesh, // 创建地形网格，game 线程
+	Barriers,		// spawn 障碍物，game 线程
+	Num,
+};
+
+// 各个阶段的输出。高度图写在 slot 的 buffer 中，CalculateTangentsForMesh 只接受 TArray，
+// 法线阶段直接读取 slot，和高度图之间只有 task 的依赖关系，因此高度图阶段没有输出
+struct FNormalStageOutput
+{
+	TArrayView<FVector> Normals;
+	TArrayView<FProcMeshTangent> Tangents;
+};
+
+struct FPointStageOutput
+{
+	int32 TotalPoints = 0;
+};
+
+// 每个阶段的耗时（秒），不同阶段只写自己的下标，因此可以被并行的阶段同时写入
+struct FTileStageTimings
 {
-	FVector2D UVPos;	 // 0 - 1 的随机变量表示点的坐标
-	FRotator Rotation; // 0 - 1 的随机变量表示点的旋转
-	FVector Scale;
+	double Seconds[(int32)ETileStage::Num] = { 0.0 };
+};
+
+UENUM()
+enum class EGenerationThreadPriority : uint8
+{
+	Lowest,
+	BelowNormal,
+	Normal,
+	AboveNormal,
 };
 
 UENUM()
@@ -38,6 +82,129 @@ enum class EDistanceFunc : uint8
 				 // Manhattan,
 };
 
+// 编译期的距离函数，PoissonSampling 按类型实例化，距离判断可以被内联
+// 返回 true 表示两点距离小于 MinDistance
+template <EDistanceFunc Func>
+struct TDistanceFunc;
+
+template <>
+struct TDistanceFunc<EDistanceFunc::Euclidean>
+{
+	FORCEINLINE bool operator()(FVector2D A, FVector2D B, double MinDistance) const
+	{
+		return FVector2D::DistSquared(A, B) < MinDistance * MinDistance;
+	}
+};
+
+template <>
+struct TDistanceFunc<EDistanceFunc::Xaxis>
+{
+	static constexpr int32 Axis = 0;
+	FORCEINLINE bool operator()(FVector2D A, FVector2D B, double MinDistance) const
+	{
+		return FMath::Abs(A.X - B.X) < MinDistance;
+	}
+};
+
+template <>
+struct TDistanceFunc<EDistanceFunc::Yaxis>
+{
+	static constexpr int32 Axis = 1;
+	FORCEINLINE bool operator()(FVector2D A, FVector2D B, double MinDistance) const
+	{
+		return FMath::Abs(A.Y - B.Y) < MinDistance;
+	}
+};
+
+// 一个 spawner 撒点时需要的参数
+struct FSpawnerGenConfig
+{
+	int32 BarrierGroup = 0;
+	double PoissonDistance = 0.0;
+	TArray<int32> MinBarrierCount;
+	TArray<int32> MaxBarrierCount;
+	TOptional<FCoinTrajectoryParams> CoinTrajectory; // 设置时 worker 在撒点之后规划金币轨迹
+	bool bPlanTransforms = false; // worker 为每个点计算 transform
+	FSpawnTransformParams Transform;
+	TOptional<FClusterLayoutParams> ClusterLayout; // 设置时 worker 计算簇的布局和每个成员的 transform
+
+	int32 GetBarrierCount(double RandomValue, int32 Difficulty) const;
+};
+
+// 预计算的周期性泊松点集
+struct FPointSetLibrary
+{
+	double MinDistance = 0.0;
+	TArray<TArray<FVector2f>> Sets; // 归一化到 [0, 1)，在 tile 环绕（toroidal）意义下满足最小距离
+};
+
+// worker 线程使用的生成参数快照，创建之后不再修改，以 TSharedRef<const FWorldGenConfig> 传给每个任务
+// BeginPlay、移动世界原点和修改参数时创建新的版本，正在执行的任务继续使用派发时的版本，worker 不会访问任何 UObject
+struct FWorldGenConfig
+{
+	uint32 Version = 0;
+
+	// 地形
+	float CellSize = 0.0f;
+	int32 XCellNumber = 0;
+	int32 YCellNumber = 0;
+	FVector2D WorldOriginOffset = FVector2D::ZeroVector;
+	FVector2D TextureSize = FVector2D::ZeroVector;
+	double MaxTextureCoords = 0.0;
+	TArray<float> PerlinFreq;
+	TArray<float> PerlinAmplitude;
+	double PerlinCosTheta = 1.0;
+	double PerlinSinTheta = 0.0;
+	bool bFlattenStartTile = false; // 把起始 tile 的中心压平
+	FInt32Point StartTile;					// 绝对 tile 编号
+
+	// 撒点
+	int32 SampleCountBeforeReject = 0;
+	bool bCheckPoissonSampling = false;
+	TArray<EDistanceFunc> GroupDistanceFunc;
+	TArray<FSpawnerGenConfig> Spawners; // 和 AWorldGenerator::BarrierSpawners 的顺序一致
+
+	// 只在 BeginPlay 时生成的大块数据，不同版本之间共享
+	TSharedPtr<const TArray<int32>> Triangles;
+	TSharedPtr<const TArray<FPointSetLibrary>> PointSetLibraries; // 按 BarrierGroup 索引，只约束单轴的分组为空
+
+	double GetTileSizeX() const { return double(CellSize) * XCellNumber; }
+	double GetTileSizeY() const { return double(CellSize) * YCellNumber; }
+
+	// 已经移动过的原点对应的 tile 数量
+	int32 GetOriginTileX() const { return FMath::RoundToInt32(WorldOriginOffset.X / GetTileSizeX()); }
+
+	FVector2D GetUVFromPos(FVector Position) const;
+	double GetHeightFromPerlin(FVector2D Pos, FInt32Point CellPos) const;
+	// 地形网格顶点的高度，只依赖绝对位置，和派发时的世界原点无关
+	double GetVertexHeight(FInt32Point Tile, int32 X, int32 Y) const;
+};
+
+class AWorldGenerator;
+
+// AWorldGenerator 的第二个 tick 函数，在 TG_PostUpdateWork 中提交生成结果、spawn 障碍物和移动世界原点
+// 主 tick 在 TG_PrePhysics 中派发新的 tile，让 worker 和物理模拟并行
+USTRUCT()
+struct FWorldGeneratorCommitTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	AWorldGenerator* Target = nullptr;
+
+	void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	FString DiagnosticMessage() override;
+	FName DiagnosticContext(bool bDetailed) override;
+};
+
+template <>
+struct TStructOpsTypeTraits<FWorldGeneratorCommitTickFunction> : public TStructOpsTypeTraitsBase2<FWorldGeneratorCommitTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
 UCLASS()
 class RUNNER_API AWorldGenerator : public AActor
 {
@@ -85,6 +252,14 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation")
 	int32 SampleCountBeforeReject = 30;
 
+	// 使用 BeginPlay 时预计算的泊松点集，每个 tile 只需要查表并做一次环绕平移/翻转
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation")
+	bool bUsePrecomputedPointSets = true;
+
+	// 每个分组预计算的点集数量，越多 tile 之间的重复感越弱
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation", meta = (ClampMin = "1", EditCondition = "bUsePrecomputedPointSets"))
+	int32 PrecomputedPointSetCount = 16;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation")
 	double MaxTextureCoords = 2000.0;
 
@@ -110,11 +285,38 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation")
 	TArray<EDistanceFunc> GroupDistanceFunc;
 
+	// 使用常驻的生成线程执行 worker 阶段，避免和引擎的其它任务争抢 task graph 的 worker
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation|Threading")
+	bool bUseDedicatedGenerationThreads = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation|Threading", meta = (ClampMin = "1", ClampMax = "4", EditCondition = "bUseDedicatedGenerationThreads"))
+	int32 GenerationThreadCount = 2;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation|Threading", meta = (EditCondition = "bUseDedicatedGenerationThreads"))
+	EGenerationThreadPriority GenerationThreadPriority = EGenerationThreadPriority::Normal;
+
+	// 生成线程的 CPU 亲和性掩码，0 表示不限制
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation|Threading", meta = (EditCondition = "bUseDedicatedGenerationThreads"))
+	int64 GenerationThreadAffinityMask = 0;
+
+	// 每帧 game 线程上最多 spawn 的实例数，超出后剩余的障碍物留到下一帧继续
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation|Budget", meta = (ClampMin = "1"))
+	int32 MaxSpawnInstancesPerFrame = 24;
+
+	// 每帧 game 线程上 tile 阶段的时间预算（微秒）
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "World Generation|Budget", meta = (ClampMin = "0"))
+	float SpawnBudgetMicroseconds = 1500.0f;
+
 	// TrianglesBuffer 仅在 begin play 时被填充一次，之后只读
 	TArray<int32> TrianglesBuffer;
 	TArray<FVector2D> UV1Buffer;
 
-	// 在此之前的属性都是在运行时只读的，也允许其它线程访问
+	// 在此之前的属性只允许 game 线程访问，worker 只能读取 GenConfig 快照
+
+	// 根据当前的属性创建新版本的快照，之后派发的 tile 使用新的快照
+	// bRebuildPointSets 为 true 时重新生成预计算点集（spawner 的采样距离或分组变化时需要）
+	void RebuildGenConfig(bool bRebuildPointSets = false);
+	TSharedRef<const FWorldGenConfig> GetGenConfig() const { return GenConfig.ToSharedRef(); }
 
 	enum class EBufferState : int8
 	{
@@ -122,12 +324,49 @@ public:
 		Busy,
 		Completed
 	};
+	// 一个 slot 上的 tile 生成流水线，worker 阶段由 UE::Tasks 的依赖关系串起来
+	struct FTilePipeline
+	{
+		UE::Tasks::FTask Heights;
+		UE::Tasks::TTask<FNormalStageOutput> Normals;
+		UE::Tasks::TTask<FPointStageOutput> Points; // 不依赖高度图，可以和 Heights 并行
+		UE::Tasks::FTask Plans;											// 依赖 Heights 和 Points，为 spawner 预先规划
+		TOptional<UE::Tasks::FTaskEvent> WorkerDone; // 使用专用生成线程时，由生成线程触发
+		UE::Tasks::FTask Handoff;										// 固定在 game 线程上执行，标记 worker 阶段完成
+		int32 NextGameThreadStage = 0;							// 下一个要执行的 game 线程阶段
+		int32 StageCursor = 0;											// 当前阶段已处理的点数，用于跨帧继续
+		int32 StageState = 0;												// 当前阶段 spawner 自定义的状态
+		bool bStageStarted = false;									// 当前阶段已经执行过，之后的调用是跨帧继续
+		uint32 Serial = 0;													// 区分同一个 slot 上先后的 tile，过期的 Handoff 会被忽略
+		FTileStageTimings Timings;
+	};
+	uint32 NextPipelineSerial = 0;
+
+	// game 线程上的阶段，按 GameThreadStages 中的顺序执行，受每帧的 FSpawnBudget 限制
+	// Run 返回 false 表示预算耗尽，下一帧从 StageCursor 处继续
+	struct FGameThreadStage
+	{
+		ETileStage Stage;
+		TFunction<bool(int32 BufferIndex, FSpawnBudget& Budget)> Run;
+	};
+
 	// 仅允许 game 线程访问!
 	EBufferState BufferStateGameThreadOnly[MaxThreadCount] = { EBufferState::Idle };
-	FGraphEventRef AsyncTaskRef[MaxThreadCount]; // 异步任务引用
+	FTilePipeline Pipelines[MaxThreadCount];
 	FInt32Point TilesInBuilding[MaxThreadCount]; // 每个线程的偏移量
 	int32 PMCIndexForTile[MaxThreadCount]; // 每个线程对应的 PMC 索引
-	int32 TileCreationState[MaxThreadCount] = { 0 };
+
+	// 在 BeginPlay 中构建，新增阶段（例如碰撞 cook、LOD）只需要在这里追加
+	TArray<FGameThreadStage> GameThreadStages;
+
+	FWorldGeneratorCommitTickFunction CommitTick;
+	// 派发依赖角色移动组件的 tick，角色可能在 BeginPlay 之后才被 possess
+	TWeakObjectPtr<class ACharacter> TickPrerequisiteCharacter;
+	void UpdateTickPrerequisites();
+
+	// 已完成 tile 的各阶段累计耗时，用于调试输出
+	FTileStageTimings StageTimeTotals;
+	int32 CompletedTileCount = 0;
 
 	UPROPERTY(VisibleAnywhere, Category = "World Generation")
 	mutable TObjectPtr<class UProceduralMeshComponent> ProceduralMeshComp[MaxRegionCount];
@@ -138,11 +377,16 @@ protected:
 	void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	void InitDataBuffer();
 	void SortBarrierSpawners();
+	void BuildGameThreadStages();
 	// void SpawnBarrierSpawners();
 
+	void RegisterActorTickFunctions(bool bRegister) override;
+
 public:
-	// Called every frame
+	// Called every frame, TG_PrePhysics, 在角色移动之后派发新的 tile
 	virtual void Tick(float DeltaTime) override;
+	// TG_PostUpdateWork，由 CommitTick 调用
+	void TickPostUpdateWork(float DeltaTime);
 
 	FInt32Point GetPlayerTile() const;
 
@@ -161,26 +405,31 @@ public:
 		return false; // Tile is not found in any region
 	}
 	bool CanRemoveTile(FInt32Point Tile) const;
+	// 同时存在的 tile 数量的上限，包括还没有被移除的 tile
+	int32 GetMaxResidentTileNumber() const;
 
 	void CreateGroundMesh(int32 BufferIndex);
-	void CreateBarriers(int32 BufferIndex, int32 BarrierIndex);
+	bool CreateBarriers(int32 BufferIndex, int32 BarrierIndex, FSpawnBudget& Budget);
 	int32 GetInactivePMCIndex() const { return (ActivePMCIndex + 1) % MaxRegionCount; }
 	bool ClearInactivePMCTiles();
 
 	// 寻找一个可以替换的 section, 如果没有找到则返回 -1
 	int32 FindReplaceableSection(int32 PMCIndex);
 
-	// 发起一个异步任务来生成 tile 数据
+	// 发起一组异步任务来生成 tile 数据
 	bool GenerateOneTile(FInt32Point Tile);
+	// worker 阶段全部完成后在 game 线程上调用
+	void OnWorkerStagesCompleted(int32 BufferIndex, uint32 Serial);
+	// 阻塞等待 slot 上的 worker 阶段完成，仅用于 warm start
+	void WaitForWorkerStages(int32 BufferIndex);
+	void ReleaseBuffer(int32 BufferIndex);
 	bool CreateMeshFromTileData();
-	// 根据当前玩家的位置生成新的 tiles
-	void GenerateNewTiles();
-
-	// 该函数可以从任意线程中调用
-	FVector2D GetUVFromPosAnyThread(FVector Position) const;
-
-	// 该函数可以从任意线程中调用
-	double GetHeightFromPerlinAnyThread(FVector2D Pos, FInt32Point CellPos) const;
+	// 在预算内执行 game 线程阶段，优先处理离玩家最近的 tile
+	bool RunGameThreadStages(FSpawnBudget& Budget);
+	// 提交已完成的 tile：创建地形网格、spawn 障碍物
+	void CommitGeneratedTiles();
+	// 根据当前玩家的位置派发新的 tiles
+	void DispatchNewTiles();
 
 	// 该函数可以从任意线程中调用
 	// int32 GetBarrierCountForTileAnyThread(FInt32Point Tile, int32 BarrierIndex, double RandomValue) const;
@@ -215,9 +464,6 @@ public:
 
 	void PMCClear(int32 PMCIndex);
 
-	// 对高度图进行后处理微调
-	void PostProcessHeightMap(FInt32Point Tile, TArray<FVector>& VerticesBuffer);
-
 	// FVector TransformUVToWorldPos(RandomPoint& Point, FInt32Point Tile) const;
 
 	bool ConditionalMoveWorldOrigin();
@@ -232,6 +478,10 @@ private:
 	int32 ActivePMCIndex = 0; // 当前活跃的 PMC 索引
 public:	
 	FOnWorldOriginChanged OnWorldOriginChanged; // 世界原点改变时的回调
+	FOnWorldReady OnWorldReady;									// 起始区域生成完成时的回调
+
+	// 起始区域（包括障碍物）是否已经生成完成，倒计时结束前需要检查
+	bool IsWorldReady() const { return bWorldReady; }
 	// 缓存延迟 spawn 的 spawner 需要的数据
 	TArray<double> SpecialLaserPos;
 	void RemoveSpecialLaserPos(int32 TileX)
@@ -239,7 +489,87 @@ public:
 		TileX = (TileX + MoveOriginXTile) % MoveOriginXTile;
 		SpecialLaserPos.RemoveAll([TileX](double Pos) { return FMath::FloorToInt32(Pos) == TileX; });
 	}
-	mutable TMap<FIntVector, TPair<TArray<RandomPoint>, FVector2D> > CachedSpawnData;
+	void AddSpecialLaser(FInt32Point Tile, double U)
+	{
+		SpecialLaserPos.Add(FMath::Fmod(Tile.X + U, double(MoveOriginXTile)));
+		ExclusionIndex.AddBandX(Tile, U, SpecialLaserHalfWidth);
+	}
+	// tile 被移除时清理它上面的禁止生成区域
+	void RemoveTileExclusions(FInt32Point Tile)
+	{
+		RemoveSpecialLaserPos(Tile.X);
+		ExclusionIndex.RemoveTile(Tile);
+	}
+	static constexpr double DeferredKeepOutHalfExtent = 0.15; // 延迟 spawn 的物体周围不生成障碍物
+	static constexpr double SpecialLaserHalfWidth = 0.05;			// 特殊激光前后不生成障碍物
+	FTileExclusionIndex ExclusionIndex;
+
+	// 延迟 spawn 的障碍物，等依赖的 tile 完全 commit（所有阶段完成）之后才执行
+	struct FDeferredSpawn
+	{
+		int32 BarrierIndex = 0;
+		FInt32Point Dependency; // 需要先 commit 的 tile，绝对编号，移动原点时不需要修改
+		FSpawnPlan Plan;				// worker 阶段的规划结果
+		FCachedSpawnSeeds Seeds;
+		bool bPending = false;	// 执行之后为 false，条目和其中数组的容量留给之后的 tile
+	};
+	// 一个 tile 上的延迟 spawn，执行过的条目不删除，之后落到这个槽位的 tile 复用，稳态下不再分配内存
+	struct FDeferredSpawnList
+	{
+		TArray<FDeferredSpawn, TInlineAllocator<1>> Entries;
+		int32 NumPending = 0;
+		bool bQueued = false; // 已经在 ReadyDeferredTiles 中，避免重复入队
+
+		FDeferredSpawn& AddPending()
+		{
+			auto* Entry = Entries.FindByPredicate([](const FDeferredSpawn& Existing) { return !Existing.bPending; });
+			if (!Entry)
+			{
+				Entry = &Entries.AddDefaulted_GetRef();
+			}
+			Entry->bPending = true;
+			++NumPending;
+			return *Entry;
+		}
+		void MarkDone(FDeferredSpawn& Entry)
+		{
+			Entry.bPending = false;
+			--NumPending;
+		}
+		friend void ResetTileSlotValue(FDeferredSpawnList& Value)
+		{
+			for (auto& Entry : Value.Entries)
+			{
+				Entry.bPending = false;
+			}
+			Value.NumPending = 0;
+			Value.bQueued = false;
+		}
+		friend SIZE_T GetTileSlotValueAllocatedSize(const FDeferredSpawnList& Value)
+		{
+			auto Size = Value.Entries.GetAllocatedSize();
+			for (const auto& Entry : Value.Entries)
+			{
+				Size += Entry.Plan.GetAllocatedSize() + Entry.Seeds.GetAllocatedSize();
+			}
+			return Size;
+		}
+	};
+	// 按所属 tile 存放，所有条目执行之后或者 tile 移除时删除
+	TTileSlots<FDeferredSpawnList> DeferredSpawns;
+	// 依赖的 tile -> 等待它 commit 的所属 tile（绝对编号），所属 tile 移除时从这里删除
+	TTileSlots<TArray<FInt32Point, TInlineAllocator<2>>> DeferredWaitList;
+	// 依赖可能已经满足的所属 tile（绝对编号），空闲的帧按顺序执行
+	// 移除的 tile 不从队列中删除，出队时发现 tile 不在 DeferredSpawns 中或者没有 bQueued 就跳过
+	TResizableCircularQueue<FInt32Point> ReadyDeferredTiles;
+	void EnqueueReadyDeferredTile(FInt32Point Tile, FDeferredSpawnList& List);
+
+	void AddDeferredSpawn(FInt32Point Tile, int32 BarrierIndex, FSpawnSeedView Seeds, const FSpawnPlan& Plan);
+	void DropDeferredSpawns(FInt32Point Tile);
+	// tile 的所有阶段都已完成，唤醒等待它的延迟 spawn
+	void OnTileCommitted(FInt32Point Tile);
+	// tile 已经生成并且不在流水线中
+	bool IsTileCommitted(FInt32Point Tile) const;
 private:
 	mutable TArray<FInt32Point> TileMap[MaxRegionCount]; // 用于存储生成的方格位置
 
@@ -320,6 +650,22 @@ public:
 	{
 		return PlayerStartTile;
 	}
+	// 加上已经移动过的原点，得到不随原点移动变化的 tile 编号，仅允许 game 线程调用
+	FInt32Point GetAbsoluteTile(FInt32Point Tile) const
+	{
+		auto TileSizeX = double(CellSize) * XCellNumber;
+		return FInt32Point(Tile.X + FMath::RoundToInt32(WorldOriginOffset.X / TileSizeX), Tile.Y);
+	}
+	FInt32Point GetRelativeTile(FInt32Point AbsoluteTile) const
+	{
+		auto TileSizeX = double(CellSize) * XCellNumber;
+		return FInt32Point(AbsoluteTile.X - FMath::RoundToInt32(WorldOriginOffset.X / TileSizeX), AbsoluteTile.Y);
+	}
+	// game 线程上的 spawner 使用的随机流，和 worker 使用相同的种子
+	FTileRandomStream MakeTileRandom(FInt32Point Tile, ETileRandomStream Stream, uint32 SubStream = 0) const
+	{
+		return FTileRandomStream(uint32(BarrierRandom), GetAbsoluteTile(Tile), Stream, SubStream);
+	}
 	bool GameStarted() const
 	{
 		return bGameStart;
@@ -329,68 +675,119 @@ private:
 	void UpdateEvilPos(float DeltaTime);
 
 	bool bGameStart = false;
+
+	// 在第一次 commit tick 中同步生成 PlayerStartTile 附近的 tile，避免开局时看到地形和障碍物突然出现
+	void WarmStart();
+	// 执行一个等待中的延迟 spawn，成功返回 true
+	bool SpawnOneDeferredBarrier();
+	bool bWorldReady = false;
+	bool bWarmStarting = false; // warm start 期间使用 task graph 的所有 worker，而不是专用生成线程
 	FInt32Point PlayerStartTile;
+	FInt32Point PlayerStartAbsoluteTile; // BeginPlay 时的绝对 tile 编号，压平地形使用
 
 	UPROPERTY(EditAnywhere, Category = "Evil Chase", meta = (AllowPrivateAccess = "true"))
 	double EvilPos;
 
 	// 多线程数据
 private:
+	// 泊松采样的临时数据，每个分组采样前从 slot 的 FTileArena 中分配
+	struct FPoissonScratch
+	{
+		TArenaArray<int32> Grid;				// 展平的网格，存储点在 Points 中的下标，INDEX_NONE 表示空
+		TArenaArray<int32> ActiveList;	// 活动点在 Points 中的下标
+		TArenaArray<FVector2D> Points; // 采样结果
+
+		// 网格边长不超过 MinDistance / sqrt(2)，每个格子最多一个点，格子数就是点数的上限
+		static int32 GetMaxPointCount(double XSize, double YSize, double MinDistance)
+		{
+			auto GridCellSize = MinDistance / FMath::Sqrt(2.0);
+			return FMath::CeilToInt32(XSize / GridCellSize) * FMath::CeilToInt32(YSize / GridCellSize);
+		}
+		void Prepare(FTileArena& Arena, int32 MaxPointCount)
+		{
+			Grid = Arena.MakeArray<int32>(MaxPointCount);
+			ActiveList = Arena.MakeArray<int32>(MaxPointCount);
+			Points = Arena.MakeArray<FVector2D>(MaxPointCount);
+		}
+	};
+
 	struct alignas(64) TaskBuffer
 	{
-		TArray<RandomPoint> RandomPoints; // 用于存储生成的随机点
+		FSpawnSeedBuffer SpawnSeeds;			// 用于存储生成的随机点，SoA 布局
 		TArray<int32> BarriersCount;			// 存储每个 Barrier Spawner 生成的障碍物数量
 		TArray<FVector> VerticesBuffer;
 		TArray<FVector> NormalsBuffer;
 		TArray<FVector2D> UV0Buffer;
 		TArray<FProcMeshTangent> TangentsBuffer;
-		// 这玩意怎么这么大，是否有必要每个线程一个？
-		std::mt19937_64 RandomEngine; // 随机数引擎
+		FPoissonScratch PoissonScratch;
+		TArray<FSpawnPlan> SpawnPlans; // 按 spawner 下标，没有需要规划的 spawner 为空
+		TArray<FVector3f> TangentSums; // 法线阶段按顶点累加的切线，和撒点阶段并行，不能放在 Arena 中
+		FTileArena Arena; // worker 阶段的临时数据，slot 释放时重置
+
+		// 不包括 Arena，它的溢出单独计数
+		SIZE_T GetAllocatedSize() const
+		{
+			SIZE_T Size = SpawnSeeds.GetAllocatedSize() + BarriersCount.GetAllocatedSize() + VerticesBuffer.GetAllocatedSize() + NormalsBuffer.GetAllocatedSize()
+				+ UV0Buffer.GetAllocatedSize() + TangentsBuffer.GetAllocatedSize() + SpawnPlans.GetAllocatedSize() + TangentSums.GetAllocatedSize();
+			for (const auto& Plan : SpawnPlans)
+			{
+				Size += Plan.GetAllocatedSize();
+			}
+			return Size;
+		}
 	};
 	// TaskDataBuffers 用于存储每个线程的任务数据, 64 Bytes 对齐
 	TaskBuffer TaskDataBuffers[MaxThreadCount];
-	// 在异步线程中执行
-	void GenerateOneTileAsync(int64 Seed, int32 BufferIndex, int32 Difficulty, FInt32Point Tile, FVector2D PositionOffset);
-	void GenerateRandomPointsAsync(int64 Seed, int32 BufferIndex, int32 Difficulty, FInt32Point Tile, TArray<RandomPoint>& RandomPoints);
 
-	void GenerateUniformRandomPointsAsync(int32 BufferIndex, int32 Difficulty, TArray<RandomPoint>& RandomPoints);
+	// 专用生成线程，每个线程有自己的请求队列
+	TArray<TUniquePtr<FPCGWorker>> PCGWorkers;
+	int32 NextPCGWorker = 0;
+	void StartGenerationThreads();
+	void StopGenerationThreads();
+	// 当前版本的快照，只在 game 线程上替换
+	TSharedPtr<const FWorldGenConfig> GenConfig;
+	uint32 NextGenConfigVersion = 0;
+	TSharedPtr<const TArray<int32>> SharedTriangles;
+
+	// 在异步线程中执行，只读取 Config 和 slot 自己的 TaskBuffer
+	void GenerateHeightsAsync(const FWorldGenConfig& Config, int32 BufferIndex, FInt32Point Tile, FVector2D PositionOffset);
+	// 读取同一个 slot 中 GenerateHeightsAsync 写入的高度图，调用者保证它已经完成
+	FNormalStageOutput GenerateNormalsAsync(const FWorldGenConfig& Config, int32 BufferIndex);
+	// 在专用生成线程上依次执行所有 worker 阶段
+	void ExecuteWorkerStages(const FPCGRequest& Request);
+	void GenerateRandomPointsAsync(const FWorldGenConfig& Config, int64 Seed, int32 BufferIndex, int32 Difficulty, FInt32Point Tile, FSpawnSeedBuffer& SpawnSeeds);
+
+	void GenerateUniformRandomPointsAsync(const FWorldGenConfig& Config, int64 Seed, FInt32Point Tile, int32 BufferIndex, int32 Difficulty, FSpawnSeedBuffer& SpawnSeeds);
 	// 使用泊松采样生成随机点
-	void GeneratePoissonRandomPointsAsync(int32 BufferIndex, int32 Difficulty, TArray<RandomPoint>& RandomPoints);
-
-	// 各种数学函数测试
-	using DistanceFuncType = bool (*)(FVector2D, FVector2D, double);
-	// 欧式距离
-	static bool EuclideanDistance(FVector2D A, FVector2D B, double MinDistance)
-	{
-		return FVector2D::DistSquared(A, B) < MinDistance * MinDistance;
-	}
-	// 仅考虑 X 轴距离
-	static bool XaxisDistance(FVector2D A, FVector2D B, double MinDistance)
-	{
-		return FMath::Abs(A.X - B.X) < MinDistance;
-	}
-	// 仅考虑 Y 轴距离
-	static bool YaxisDistance(FVector2D A, FVector2D B, double MinDistance)
-	{
-		return FMath::Abs(A.Y - B.Y) < MinDistance;
-	}
-	static DistanceFuncType GetDistanceFunc(EDistanceFunc Func)
-	{
-		switch (Func)
-		{
-			case EDistanceFunc::Euclidean:
-				return EuclideanDistance;
-			case EDistanceFunc::Xaxis:
-				return XaxisDistance;
-			case EDistanceFunc::Yaxis:
-				return YaxisDistance;
-			default:
-				return EuclideanDistance; // 默认使用欧式距离
-		}
-	}
-
+	void GeneratePoissonRandomPointsAsync(const FWorldGenConfig& Config, int64 Seed, FInt32Point Tile, int32 BufferIndex, int32 Difficulty, FSpawnSeedBuffer& SpawnSeeds);
+	// 根据高度图、法线和撒点结果为 spawner 规划位置（例如金币轨迹、簇布局），game 线程只需要创建物体
+	// RandomTile 为绝对 tile 编号，和撒点使用的随机流一致
+	void PlanSpawnersAsync(const FWorldGenConfig& Config, int64 Seed, int32 BufferIndex, FInt32Point Tile, FInt32Point RandomTile);
+
+	// 预计算的周期性泊松点集，在 game 线程上生成，之后通过快照共享给 worker
+	TSharedPtr<const TArray<FPointSetLibrary>> PointSetLibraries;
+	void BuildPointSetLibraries();
+
+	// 生成 tile 时向堆申请内存的累计次数，稳态下应当不再增长
+	// 包括 FTileArena 的溢出，以及 slot、延迟 spawn、禁止区域和 spawner 中按 tile 存放的容器超过历史最大容量的次数
+	uint32 TileHeapAllocations = 0;
+	SIZE_T TileStorageHighWater = 0;
+	SIZE_T GetTileStorageAllocatedSize() const;
+	// 根据随机数选择一个点集并做环绕平移和翻转，结果追加到 OutPoints 中
+	static int32 SamplePrecomputedPoints(const FPointSetLibrary& Library, double XSize, double YSize, FTileRandomStream& Random, TArenaArray<FVector2D>& OutPoints);
+	// 周期边界的泊松采样，用于生成预计算点集
+	static int32 PeriodicPoissonSampling(double XSize, double YSize, double MinDistance, int32 SampleCountBeforeReject, FTileRandomStream& Random, FPoissonScratch& Scratch);
+
+	// 按分组的距离函数选择采样器，结果追加到 Scratch.Points 中，返回新生成的点数
+	static int32 SampleGroupPoints(EDistanceFunc Func, double XSize, double YSize, double MinDistance, int32 MaxPoints, int32 SampleCountBeforeReject, FTileRandomStream& Random, FPoissonScratch& Scratch);
+
+	// 采样结果追加到 Scratch.Points 中，返回新生成的点数
 	template <class T>
-	static int32 PoissonSampling(double XSize, double YSize, double MinDistance, int32 SampleCountBeforeReject, std::mt19937_64& RandomEngine, T DistLambda, TArray<FVector2D>& OutPoints);
+	static int32 PoissonSampling(double XSize, double YSize, double MinDistance, int32 SampleCountBeforeReject, FTileRandomStream& Random, T DistLambda, FPoissonScratch& Scratch);
+	// 只约束一个轴上距离的分组使用一维采样，O(n) 且精确，不需要拒绝采样
+	// 在该轴上生成 min(MaxPoints, 能容纳的最大点数) 个间距不小于 MinDistance 的点，另一个轴均匀分布
+	template <int32 Axis>
+	static int32 AxisSpacingSampling(double XSize, double YSize, double MinDistance, int32 MaxPoints, FTileRandomStream& Random, TArenaArray<FVector2D>& OutPoints);
 
 	// 二维高斯分布
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Math|Gaussian", meta = (AllowPrivateAccess = "true"))
@@ -669,6 +669,17 @@ void ARunnerCharacter::NotifyActorBeginOverlap(AActor* OtherActor)
 	// UE_LOG(LogRunnerCharacter, Warning, TEXT("ARunnerCharacter::NotifyActorBeginOverlap: %s"), *OtherActor->GetName());
 }
 
+void ARunnerCharacter::CollectCoin()
+{
+	Health += CoinHealHealth;
+	Health = FMath::Min(Health, MaxHealth);
+	GameUIWidget->AddOneCoin(CoinHealHealth / MaxHealth);
+	if (!CoinAudio->IsPlaying() || bAllowInterruptCoinSound)
+	{
+		CoinAudio->Play();
+	}
+}
+
 void ARunnerCharacter::DealBarrierOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
 		UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep,
 		FHitResult const& SweepResult)
@@ -676,13 +687,7 @@ void ARunnerCharacter::DealBarrierOverlap(UPrimitiveComponent* OverlappedCompone
 	if (OtherComp->ComponentHasTag("GoldCoin"))
 	{
 		// UE_LOG(LogRunnerCharacter, Warning, TEXT("ARunnerCharacter::DealBarrierOverlap: Get Coin %d"), OtherBodyIndex);
-		Health += CoinHealHealth;
-		Health = FMath::Min(Health, MaxHealth);
-		GameUIWidget->AddOneCoin(CoinHealHealth / MaxHealth);
-		if (!CoinAudio->IsPlaying() || bAllowInterruptCoinSound)
-		{
-			CoinAudio->Play();
-		}
+		CollectCoin();
 	}
 	else if (OtherComp->ComponentHasTag("Mud"))
 	{
@@ -101,6 +101,9 @@ public:
 	void DealBarrierOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
 			UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
+	// 拾取一个金币，金币 actor 的重叠和 UCoinFieldComponent 的距离检测都会调用
+	void CollectCoin();
+
 	void EnterMud();
 	void OutOfMud();
 